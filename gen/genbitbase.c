@@ -0,0 +1,191 @@
+/*
+ * Builds the king and pawn, king and rook and king and queen against king
+ * bitbases and writes them to the file named by its first argument. See
+ * bitbase.h for the layout.
+ *
+ * Every table starts out with nothing marked as won. Each pass then marks
+ * white to move positions that have a move into a won position, and black
+ * to move positions that are mate or whose every move leads into a won
+ * position, working backwards from the mates until a pass changes nothing.
+ * Whatever is left unmarked is a draw.
+ */
+#include "bitbase.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SQ BITBASE_SQUARES
+#define sq_x(sq) ((sq) % BOARD_LENGTH)
+#define sq_y(sq) ((sq) / BOARD_LENGTH)
+
+enum { KPK, KRK, KQK };
+
+static const chess_p extra[BITBASE_TABLES] = { PAWN, ROOK, QUEEN };
+
+static unsigned char tables[BITBASE_TABLES][BITBASE_TABLE_LEN];
+
+static bool won(int t, int i) {
+	return tables[t][i / 8] >> (i % 8) & 1;
+}
+
+static void mark(int t, int i) {
+	tables[t][i / 8] |= 1 << (i % 8);
+}
+
+static bool out_of_bounds(int x, int y) {
+	return x < 0 || y < 0 || x >= BOARD_LENGTH || y >= BOARD_HEIGHT;
+}
+
+static bool adjacent(int a, int b) {
+	return abs(sq_x(a) - sq_x(b)) <= 1 && abs(sq_y(a) - sq_y(b)) <= 1;
+}
+
+static int sign(int n) {
+	return (n > 0) - (n < 0);
+}
+
+// true if white's piece p on ps attacks target, with only the kings in the way
+static bool attacks(chess_p p, int ps, int target, int wk, int bk) {
+	int dx = sq_x(target) - sq_x(ps);
+	int dy = sq_y(target) - sq_y(ps);
+	if (PAWN == p)
+		return -1 == dy && 1 == abs(dx);
+	if (0 == dx && 0 == dy)
+		return false;
+	bool straight = 0 == dx || 0 == dy;
+	bool diagonal = abs(dx) == abs(dy);
+	if (!straight && !(diagonal && QUEEN == p))
+		return false;
+	int x = sq_x(ps) + sign(dx), y = sq_y(ps) + sign(dy);
+	for (; x != sq_x(target) || y != sq_y(target); x += sign(dx), y += sign(dy)) {
+		int sq = y * BOARD_LENGTH + x;
+		if (sq == wk || sq == bk)
+			return false;
+	}
+	return true;
+}
+
+static bool legal(chess_p p, int to_move, int wk, int bk, int ps) {
+	if (wk == bk || wk == ps || bk == ps || adjacent(wk, bk))
+		return false;
+	if (PAWN == p && (0 == sq_y(ps) || BOARD_HEIGHT - 1 == sq_y(ps)))
+		return false;
+	// black can't have been left in check with white to move
+	return 1 == to_move || !attacks(p, ps, bk, wk, bk);
+}
+
+static bool white_wins(int t, int wk, int bk, int ps) {
+	chess_p p = extra[t];
+	for (int dx = -1; dx <= 1; ++dx) {
+		for (int dy = -1; dy <= 1; ++dy) {
+			int x = sq_x(wk) + dx, y = sq_y(wk) + dy;
+			int to = y * BOARD_LENGTH + x;
+			if ((!dx && !dy) || out_of_bounds(x, y) || to == ps || adjacent(to, bk))
+				continue;
+			if (won(t, bitbase_index(1, to, bk, ps)))
+				return true;
+		}
+	}
+	if (PAWN == p) {
+		int to = ps - BOARD_LENGTH;
+		if (to == wk || to == bk)
+			return false;
+		// a new queen or rook takes over from their own tables
+		if (0 == sq_y(to))
+			return won(KQK, bitbase_index(1, wk, bk, to)) || won(KRK, bitbase_index(1, wk, bk, to));
+		if (won(t, bitbase_index(1, wk, bk, to)))
+			return true;
+		int twice = to - BOARD_LENGTH;
+		return BOARD_HEIGHT - 2 == sq_y(ps) && twice != wk && twice != bk &&
+			won(t, bitbase_index(1, wk, bk, twice));
+	}
+	for (int dx = -1; dx <= 1; ++dx) {
+		for (int dy = -1; dy <= 1; ++dy) {
+			if ((!dx && !dy) || (ROOK == p && dx && dy))
+				continue;
+			int x = sq_x(ps) + dx, y = sq_y(ps) + dy;
+			for (; !out_of_bounds(x, y); x += dx, y += dy) {
+				int to = y * BOARD_LENGTH + x;
+				if (to == wk || to == bk)
+					break;
+				if (won(t, bitbase_index(1, wk, bk, to)))
+					return true;
+			}
+		}
+	}
+	return false;
+}
+
+static bool black_loses(int t, int wk, int bk, int ps) {
+	chess_p p = extra[t];
+	int moves = 0;
+	for (int dx = -1; dx <= 1; ++dx) {
+		for (int dy = -1; dy <= 1; ++dy) {
+			int x = sq_x(bk) + dx, y = sq_y(bk) + dy;
+			int to = y * BOARD_LENGTH + x;
+			if ((!dx && !dy) || out_of_bounds(x, y) || adjacent(to, wk))
+				continue;
+			// taking the last piece off the board is a draw
+			if (to == ps)
+				return false;
+			// the king no longer stands in the way of the piece once it moves
+			if (attacks(p, ps, to, wk, to))
+				continue;
+			moves++;
+			if (!won(t, bitbase_index(0, wk, to, ps)))
+				return false;
+		}
+	}
+	// mate if in check, stalemate if not
+	return moves > 0 || attacks(p, ps, bk, wk, bk);
+}
+
+static void generate(int t) {
+	bool changed = true;
+	int passes = 0, wins = 0;
+	while (changed) {
+		changed = false;
+		passes++;
+		for (int to_move = 0; to_move < 2; ++to_move) {
+			for (int wk = 0; wk < SQ; ++wk) {
+				for (int bk = 0; bk < SQ; ++bk) {
+					for (int ps = 0; ps < SQ; ++ps) {
+						int i = bitbase_index(to_move, wk, bk, ps);
+						if (won(t, i) || !legal(extra[t], to_move, wk, bk, ps))
+							continue;
+						if (to_move ? black_loses(t, wk, bk, ps) : white_wins(t, wk, bk, ps)) {
+							mark(t, i);
+							changed = true;
+							wins++;
+						}
+					}
+				}
+			}
+		}
+	}
+	printf("%s: %d won positions after %d passes\n",
+			(KPK == t) ? "KPK" : (KRK == t) ? "KRK" : "KQK", wins, passes);
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s FILE\n", argv[0]);
+		return 1;
+	}
+	// promotions look their results up in the queen and rook tables
+	generate(KQK);
+	generate(KRK);
+	generate(KPK);
+	FILE *out = fopen(argv[1], "wb");
+	if (NULL == out) {
+		perror(argv[1]);
+		return 1;
+	}
+	fwrite(BITBASE_MAGIC, 1, BITBASE_MAGIC_LEN, out);
+	fwrite(tables, 1, sizeof tables, out);
+	if (fclose(out)) {
+		perror(argv[1]);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,199 @@
+/*
+ * Prints chess_tables.h to stdout: every lookup table the rules engine would
+ * otherwise work out with arithmetic on each call. Squares are numbered
+ * (y * BOARD_LENGTH + x), the same way as the piece sets in chess_t, and
+ * lists of squares end with -1.
+ */
+#include "chess.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+#define SQUARES (BOARD_LENGTH * BOARD_HEIGHT)
+
+// even directions are rook lines, odd directions are bishop lines
+static const int king_dirs[8][2] = {
+	{ 0,  1}, { 1,  1}, { 1,  0}, { 1, -1},
+	{ 0, -1}, {-1, -1}, {-1,  0}, {-1,  1}
+};
+
+static const int horse_dirs[8][2] = {
+	{ 1,  2}, { 2,  1}, { 2, -1}, { 1, -2},
+	{-1, -2}, {-2, -1}, {-2,  1}, {-1,  2}
+};
+
+static bool out_of_bounds(int x, int y) {
+	return x < 0 || y < 0 || x >= BOARD_LENGTH || y >= BOARD_HEIGHT;
+}
+
+static int square(int x, int y) {
+	return out_of_bounds(x, y) ? -1 : y * BOARD_LENGTH + x;
+}
+
+static void print_dirs(const char *name, const int dirs[8][2]) {
+	printf("static const int %s[8][2] = {\n", name);
+	for (int i = 0; i < 8; ++i)
+		printf("\t{%2d, %2d},\n", dirs[i][0], dirs[i][1]);
+	printf("};\n\n");
+}
+
+static void print_list(const int *list, int len) {
+	printf("{");
+	for (int i = 0; i < len; ++i)
+		printf("%s%d", i ? ", " : "", list[i]);
+	printf("}");
+}
+
+// every square a piece reaches in one hop from each square, in dirs order
+static void print_hops(const char *name, const int dirs[8][2]) {
+	printf("static const int8_t %s[%d][9] = {\n", name, SQUARES);
+	for (int sq = 0; sq < SQUARES; ++sq) {
+		int list[9], n = 0;
+		for (int i = 0; i < 8; ++i) {
+			int t = square(sq % BOARD_LENGTH + dirs[i][0], sq / BOARD_LENGTH + dirs[i][1]);
+			if (t >= 0)
+				list[n++] = t;
+		}
+		list[n++] = -1;
+		printf("\t");
+		print_list(list, n);
+		printf(",\n");
+	}
+	printf("};\n\n");
+}
+
+static void print_rays(void) {
+	printf("static const int8_t ray_sq[8][%d][%d] = {\n", SQUARES, BOARD_LENGTH);
+	for (int i = 0; i < 8; ++i) {
+		printf("\t{\n");
+		for (int sq = 0; sq < SQUARES; ++sq) {
+			int list[BOARD_LENGTH], n = 0;
+			int x = sq % BOARD_LENGTH, y = sq / BOARD_LENGTH;
+			while (!out_of_bounds(x += king_dirs[i][0], y += king_dirs[i][1]))
+				list[n++] = square(x, y);
+			list[n++] = -1;
+			printf("\t\t");
+			print_list(list, n);
+			printf(",\n");
+		}
+		printf("\t},\n");
+	}
+	printf("};\n\n");
+}
+
+static void print_between(void) {
+	printf("static const uint64_t between[%d][%d] = {\n", SQUARES, SQUARES);
+	for (int from = 0; from < SQUARES; ++from) {
+		printf("\t{");
+		for (int to = 0; to < SQUARES; ++to) {
+			unsigned long long mask = 0;
+			int fx = from % BOARD_LENGTH, fy = from / BOARD_LENGTH;
+			int tx = to % BOARD_LENGTH, ty = to / BOARD_LENGTH;
+			int dx = (tx > fx) - (tx < fx);
+			int dy = (ty > fy) - (ty < fy);
+			// only squares sharing a rank, file or diagonal have anything between them
+			if (from != to && (dx == 0 || dy == 0 || tx - fx == (ty - fy) * dx * dy))
+				for (int x = fx + dx, y = fy + dy; x != tx || y != ty; x += dx, y += dy)
+					mask |= 1ULL << square(x, y);
+			printf("%s%#llxULL", (to % 4) ? ", " : (to ? ",\n\t " : ""), mask);
+		}
+		printf("},\n");
+	}
+	printf("};\n\n");
+}
+
+static void print_pawns(void) {
+	printf("static const int8_t pawn_push[2][%d] = {\n", SQUARES);
+	for (color c = WHITE; c <= BLACK; ++c) {
+		int sign = (c == WHITE) ? -1 : 1;
+		int list[SQUARES];
+		for (int sq = 0; sq < SQUARES; ++sq)
+			list[sq] = square(sq % BOARD_LENGTH, sq / BOARD_LENGTH + sign);
+		printf("\t");
+		print_list(list, SQUARES);
+		printf(",\n");
+	}
+	printf("};\n\n");
+
+	printf("static const int8_t pawn_double[2][%d] = {\n", SQUARES);
+	for (color c = WHITE; c <= BLACK; ++c) {
+		int sign = (c == WHITE) ? -1 : 1;
+		int start = (c == WHITE) ? BOARD_HEIGHT - 2 : 1;
+		int list[SQUARES];
+		for (int sq = 0; sq < SQUARES; ++sq)
+			list[sq] = (sq / BOARD_LENGTH == start)
+				? square(sq % BOARD_LENGTH, sq / BOARD_LENGTH + 2 * sign)
+				: -1;
+		printf("\t");
+		print_list(list, SQUARES);
+		printf(",\n");
+	}
+	printf("};\n\n");
+
+	// the two squares a pawn takes on, towards the a file first
+	printf("static const int8_t pawn_take[2][%d][2] = {\n", SQUARES);
+	for (color c = WHITE; c <= BLACK; ++c) {
+		int sign = (c == WHITE) ? -1 : 1;
+		printf("\t{\n");
+		for (int sq = 0; sq < SQUARES; ++sq) {
+			int x = sq % BOARD_LENGTH, y = sq / BOARD_LENGTH;
+			int list[2] = { square(x - 1, y + sign), square(x + 1, y + sign) };
+			printf("\t\t");
+			print_list(list, 2);
+			printf(",\n");
+		}
+		printf("\t},\n");
+	}
+	printf("};\n\n");
+}
+
+// splitmix64, so the keys come out the same on every build
+static unsigned long long next_key(void) {
+	static unsigned long long state = 0x63686573735f6b65ULL;
+	unsigned long long z = (state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+static void print_keys(const char *name, int n) {
+	printf("static const uint64_t %s[%d] = {\n", name, n);
+	for (int i = 0; i < n; ++i)
+		printf("%s%#018llxULL", (i % 4) ? ", " : (i ? ",\n\t" : "\t"), next_key());
+	printf("\n};\n\n");
+}
+
+// zobrist keys: one per piece on each square, castle right, en passant file and black to move
+static void print_zobrist(void) {
+	printf("static const uint64_t zobrist_pieces[2][%d][%d] = {\n", CHESS_NUM_PIECES, SQUARES);
+	for (int c = 0; c < 2; ++c) {
+		printf("\t{\n");
+		for (int p = 0; p < CHESS_NUM_PIECES; ++p) {
+			printf("\t\t{");
+			for (int sq = 0; sq < SQUARES; ++sq)
+				printf("%s%#018llxULL", (sq % 4) ? ", " : (sq ? ",\n\t\t " : ""), next_key());
+			printf("},\n");
+		}
+		printf("\t},\n");
+	}
+	printf("};\n\n");
+	print_keys("zobrist_castle", 4);
+	print_keys("zobrist_ep", BOARD_LENGTH);
+	print_keys("zobrist_turn", 1);
+}
+
+int main(void) {
+	printf("/* generated by gen/gentables.c, do not edit */\n"
+	       "#ifndef CHESS_TABLES_H_\n"
+	       "#define CHESS_TABLES_H_\n\n"
+	       "#include <stdint.h>\n\n");
+	print_dirs("king_dirs", king_dirs);
+	print_dirs("horse_dirs", horse_dirs);
+	print_hops("king_sq", king_dirs);
+	print_hops("horse_sq", horse_dirs);
+	print_rays();
+	print_between();
+	print_pawns();
+	print_zobrist();
+	printf("#endif /* CHESS_TABLES_H_ */\n");
+	return 0;
+}
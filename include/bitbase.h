@@ -0,0 +1,48 @@
+#ifndef BITBASE_H_
+#define BITBASE_H_
+
+#include "chess.h"
+#include <stddef.h>
+
+/*
+ * An endgame bitbase file starts with BITBASE_MAGIC, followed by one table
+ * each for king and pawn, king and rook and king and queen against a lone
+ * king, in that order. Every table holds one bit per position, set if the
+ * side with the extra piece wins, at bit
+ *
+ *	((to_move * 64 + strong king) * 64 + weak king) * 64 + piece
+ *
+ * where to_move is 0 when the strong side is to move, squares are numbered
+ * (y * BOARD_LENGTH + x), and positions are mirrored so the strong side is
+ * always white. Illegal positions read as draws.
+ */
+
+#define BITBASE_MAGIC "CHESSBB1"
+#define BITBASE_MAGIC_LEN 8
+#define BITBASE_SQUARES (BOARD_LENGTH * BOARD_HEIGHT)
+#define BITBASE_POSITIONS (2 * BITBASE_SQUARES * BITBASE_SQUARES * BITBASE_SQUARES)
+#define BITBASE_TABLE_LEN (BITBASE_POSITIONS / 8)
+#define BITBASE_TABLES 3
+#define BITBASE_FILE_LEN (BITBASE_MAGIC_LEN + BITBASE_TABLES * BITBASE_TABLE_LEN)
+
+#define bitbase_index(to_move, sk, wk, p) \
+	((((to_move) * BITBASE_SQUARES + (sk)) * BITBASE_SQUARES + (wk)) * BITBASE_SQUARES + (p))
+
+// win, draw or loss for the side to move
+typedef enum {
+	CHESS_WDL_NONE = -2,
+	CHESS_WDL_LOSS = -1,
+	CHESS_WDL_DRAW = 0,
+	CHESS_WDL_WIN = 1
+} chess_wdl;
+
+typedef struct {
+	const unsigned char *data;
+	size_t size;
+} chess_bitbase;
+
+int chess_bitbase_open(chess_bitbase*, const char *);
+chess_wdl chess_bitbase_probe(const chess_bitbase*, const chess_t*);
+void chess_bitbase_close(chess_bitbase*);
+
+#endif /* BITBASE_H_ */
@@ -0,0 +1,44 @@
+#ifndef BOOK_H_
+#define BOOK_H_
+
+#include "chess.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * An opening book is a file of 16 byte big-endian entries, laid out the same
+ * way as a Polyglot book: the position's hash (chess_t.hash), the move, its
+ * weight and 4 bytes of learning data we ignore. Entries are sorted by hash
+ * so every position's moves sit next to each other.
+ *
+ * A move packs the destination file and rank into bits 0-5, the origin file
+ * and rank into bits 6-11 (rank 0 is white's back rank) and the promotion
+ * piece into bits 12-14 (1 knight, 2 bishop, 3 rook, 4 queen). Castling is
+ * written as the king taking its own rook.
+ *
+ * chess_t.hash isn't the Polyglot key, so a book Polyglot wrote finds
+ * nothing here. chess-index book makes one from a corpus of games.
+ */
+
+#define CHESS_BOOK_ENTRY 16
+
+typedef struct {
+	int x, y, tx, ty;
+	chess_p promote;
+	unsigned int weight;
+} chess_book_move;
+
+typedef struct {
+	const unsigned char *data;
+	size_t size;
+	size_t entries;
+} chess_book;
+
+int chess_book_open(chess_book*, const char *);
+size_t chess_book_probe(const chess_book*, const chess_t*, chess_book_move*, size_t);
+uint16_t chess_book_pack(const chess_t*, const chess_move*);
+void chess_book_entry(uint64_t, uint16_t, unsigned int, unsigned char [CHESS_BOOK_ENTRY]);
+size_t chess_book_san(const chess_t*, const chess_book_move*, char [8]);
+void chess_book_close(chess_book*);
+
+#endif /* BOOK_H_ */
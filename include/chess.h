@@ -1,6 +1,10 @@
 #ifndef CHESS_H_
 #define CHESS_H_
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 // number of unique pieces per player on the board
 #define CHESS_NUM_PIECES 6
 
@@ -60,9 +64,15 @@ typedef struct {
 	int kpos[2][2];
 	color turn, check;
 	castle_state castle;
+	// one bit per square, (y * BOARD_LENGTH + x), for each color and piece type
+	uint64_t pieces[2][CHESS_NUM_PIECES];
+	// zobrist hash of the pieces, castle rights, en passant file and side to move
+	uint64_t hash;
 	unsigned int moves;
-	unsigned int h_len, h_end;
-	char *history;
+	// plies since the last capture or pawn move, for the fifty-move rule
+	unsigned int halfmoves;
+	// the moves played and the history written from them, see chess_history()
+	struct chess_arena *arena;
 } chess_t;
 
 typedef enum {
@@ -79,11 +89,136 @@ typedef enum {
 	CHESS_END = 2,
 } chess_return;
 
+// a move given by its squares, as in e2e4, promote is BLANK unless a pawn promotes
+typedef struct {
+	int x, y, tx, ty;
+	chess_p promote;
+} chess_move;
+
+// no position has more legal moves than this
+#define CHESS_MAX_MOVES 256
+// nor more moves that follow how the pieces move, legal or not
+#define CHESS_MAX_CANDIDATES 512
+// the longest a FEN string gets, with its terminator
+#define CHESS_FEN_MAX 104
+// the most games chess_replay_batch() plays in lockstep
+#define CHESS_REPLAY_LANES 16
+
+// a position on its own, without a game around it. en passant is a phantom pawn on b
+typedef struct {
+	board b;
+	color turn;
+	castle_state castle;
+} chess_pos;
+
+typedef struct {
+	// CHESS_NORMAL, CHESS_CHECK, CHESS_MATE or CHESS_STALE, CHESS_ERR without both kings
+	chess_return state;
+	unsigned int moves;
+} chess_result;
+
+/*
+ * a game for chess_replay_batch() to check: the position it starts from
+ * as FEN, NULL for the usual one, and its moves in SAN as chess_history()
+ * writes them. state gets what the last move returned, or what stopped
+ * the game: the error of the move that failed, or CHESS_ERR if fen
+ * couldn't be read. plies gets how many moves were played and hash the
+ * position they reached
+ */
+typedef struct {
+	const char *fen, *history;
+	chess_return state;
+	unsigned int plies;
+	uint64_t hash;
+} chess_replay;
+
+/*
+ * a packed position is the occupied squares as 64 bits, little endian,
+ * then a nibble for each of those squares in order, low nibble first:
+ * the piece with the color in the top bit. then a byte with the side to
+ * move in bit 0 and the castle rights above it, and a byte with the en
+ * passant file plus one, 0 if there is none, and the caller's label in
+ * its top four bits. that is 26 bytes with all 32 pieces on the board,
+ * and no more than CHESS_PACKED_MAX for any position chess_load_fen() takes
+ */
+#define CHESS_PACKED_MAX 42
+
+// how many plies apart a game keeps checkpoints unless told otherwise
+#define CHESS_CHECKPOINT_PLIES 32
+
+/*
+ * the position as it stood ply plies into a game, small enough to store
+ * next to its history. each square, numbered y * BOARD_LENGTH + x, is a
+ * nibble: 0 if empty, else the piece plus one with the color in the top
+ * bit, even squares in the low nibble. ep is the en passant square, -1 if
+ * there is none. halfmoves is the halfmove clock, held at 255 past that.
+ * ply is in the byte order of the machine that wrote it
+ */
+typedef struct {
+	uint32_t ply;
+	uint8_t squares[BOARD_LENGTH * BOARD_HEIGHT / 2];
+	int8_t ep;
+	uint8_t castle, turn, halfmoves;
+} chess_checkpoint;
+
+/*
+ * hands out the legal moves of a position a few at a time, see
+ * chess_gen_next(). it is only spelled out here so it can live on the stack
+ */
+typedef enum {
+	CHESS_GEN_TACTICAL,
+	CHESS_GEN_QUIET
+} chess_gen_stage;
+
+typedef struct {
+	chess_t *chess;
+	chess_gen_stage stage;
+	size_t n, next;
+	chess_move moves[CHESS_MAX_CANDIDATES];
+	int16_t score[CHESS_MAX_CANDIDATES];
+} chess_gen;
+
+/*
+ * hands out games whose chess_t and first arena block come from large
+ * slabs, and takes them back when they are cleaned up. each thread keeps
+ * its own free list, so games started and ended on different threads
+ * don't wait on each other or on malloc
+ */
+typedef struct chess_pool chess_pool;
+
 //void chess_init(chess_t*);
 void reset(chess_t*);
 chess_return move(chess_t*, char *);
+chess_return chess_move_coord(chess_t*, int, int, int, int, chess_p);
+chess_return chess_move_lan(chess_t*, const char *);
+chess_return chess_undo(chess_t*);
+chess_return chess_redo(chess_t*);
+int chess_last_move(const chess_t*, chess_move*);
+void chess_set_checkpoints(chess_t*, unsigned int);
+size_t chess_checkpoints(const chess_t*, const chess_checkpoint**);
+chess_return chess_seek(chess_t*, unsigned int);
+chess_return chess_seek_history(chess_t*, const char *, const chess_checkpoint*, size_t, unsigned int);
+size_t chess_serialize(const chess_t*, void *, size_t);
+int chess_deserialize(chess_t*, const void *, size_t);
+size_t chess_pack_position(const chess_t*, unsigned int, unsigned char *);
+size_t chess_unpack_position(chess_t*, const unsigned char *, size_t, unsigned int *);
+size_t chess_legal_moves(chess_t*, chess_move*);
+uint64_t chess_targets(chess_t*, int);
+size_t chess_mobility(chess_t*);
+void chess_gen_init(chess_gen*, chess_t*);
+bool chess_gen_next(chess_gen*, chess_move*);
+int chess_see(const chess_t*, int, int);
+void chess_classify_batch(const chess_pos *, size_t, chess_result *);
+void chess_replay_batch(chess_replay*, size_t, unsigned int);
+int chess_load_fen(chess_t*, const char *);
+size_t chess_fen(const chess_t*, char *);
+size_t chess_start_fen(const chess_t*, char *);
+const char *chess_history(chess_t*);
 char *print_color(color);
 void cleanup (chess_t*);
+chess_pool *chess_pool_new(void);
+chess_t *chess_pool_get(chess_pool*);
+void chess_pool_free(chess_pool*);
 
 //extern color chess_turn;
 
@@ -0,0 +1,58 @@
+#ifndef INDEX_H_
+#define INDEX_H_
+
+#include "chess.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A position index is written by chess-index from a corpus of games and
+ * read back in place through mmap, so it is in the byte order of the
+ * machine that built it. It starts with INDEX_MAGIC and the number of
+ * positions and moves, then holds every position reached, sorted by
+ * chess_t.hash, and after them every move played from each position, most
+ * played first. A position's moves are moves[first] to
+ * moves[first + n_moves - 1].
+ *
+ * A move packs the origin square (y * BOARD_LENGTH + x) into bits 0-5,
+ * the destination into bits 6-11 and the promotion piece into bits 12-14.
+ * A castle is the king moving two squares. Move 0 stands for the game
+ * ending in that position.
+ */
+
+#define INDEX_MAGIC "CHESSIX1"
+#define INDEX_MAGIC_LEN 8
+
+typedef struct {
+	uint64_t hash;
+	// games that reached the position, and how many white won, drew and black won
+	uint32_t games, white, draws, black;
+	uint32_t first, n_moves;
+} chess_index_pos;
+
+typedef struct {
+	uint16_t move;
+	uint16_t unused;
+	uint32_t games;
+} chess_index_move;
+
+typedef struct {
+	char magic[INDEX_MAGIC_LEN];
+	uint64_t n_positions, n_moves;
+} chess_index_header;
+
+typedef struct {
+	const unsigned char *data;
+	size_t size;
+	const chess_index_pos *positions;
+	const chess_index_move *moves;
+	size_t n_positions, n_moves;
+} chess_index;
+
+int chess_index_open(chess_index*, const char *);
+const chess_index_pos *chess_index_probe(const chess_index*, uint64_t);
+uint16_t chess_index_pack(const chess_move*);
+void chess_index_unpack(uint16_t, chess_move*);
+void chess_index_close(chess_index*);
+
+#endif /* INDEX_H_ */
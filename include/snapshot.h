@@ -0,0 +1,40 @@
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include "chess.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A snapshot holds many games at once, as chess_serialize() writes them,
+ * and is read back in place through mmap, so it is in the byte order of
+ * the machine that wrote it. It starts with SNAPSHOT_MAGIC and the number
+ * of games, then an entry for each giving the id the caller keeps it
+ * under and where its bytes lie in the file, then the games themselves.
+ */
+
+#define SNAPSHOT_MAGIC "CHESSSN1"
+#define SNAPSHOT_MAGIC_LEN 8
+
+typedef struct {
+	char magic[SNAPSHOT_MAGIC_LEN];
+	uint64_t n_games;
+} chess_snapshot_header;
+
+typedef struct {
+	uint64_t id, offset, size;
+} chess_snapshot_entry;
+
+typedef struct {
+	const unsigned char *data;
+	size_t size;
+	const chess_snapshot_entry *games;
+	size_t n_games;
+} chess_snapshot;
+
+int chess_snapshot_write(const char *, const uint64_t *, chess_t *const *, size_t);
+int chess_snapshot_open(chess_snapshot*, const char *);
+int chess_snapshot_load(const chess_snapshot*, size_t, chess_t*);
+void chess_snapshot_close(chess_snapshot*);
+
+#endif /* SNAPSHOT_H_ */
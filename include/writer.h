@@ -0,0 +1,43 @@
+#ifndef WRITER_H_
+#define WRITER_H_
+
+#include "chess.h"
+#include <stddef.h>
+
+/*
+ * Writes finished games to a file descriptor, either as PGN or as one
+ * JSON object per line (NDJSON) holding the tags, result, termination,
+ * SAN moves and the final position in FEN. Games are gathered in one
+ * buffer and only written out when it fills, or on a flush.
+ */
+
+#define CHESS_WRITER_BUF (1 << 20)
+
+typedef enum {
+	CHESS_PGN,
+	CHESS_NDJSON
+} chess_format;
+
+/*
+ * the tags to write with a game, any left NULL are written as "?". result
+ * and termination are only needed when the game ended some way the board
+ * doesn't show, like a resignation; otherwise they come from the position
+ */
+typedef struct {
+	const char *event, *site, *date, *round, *white, *black;
+	const char *result, *termination;
+} chess_tags;
+
+typedef struct {
+	int fd;
+	chess_format format;
+	char *buf;
+	size_t len, cap;
+} chess_writer;
+
+int chess_writer_init(chess_writer*, int, chess_format, size_t);
+int chess_write_game(chess_writer*, chess_t*, const chess_tags*);
+int chess_writer_flush(chess_writer*);
+int chess_writer_free(chess_writer*);
+
+#endif /* WRITER_H_ */
@@ -0,0 +1,95 @@
+#include "bitbase.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// returns 0 on success, -1 if the file can't be mapped or isn't a bitbase
+int chess_bitbase_open(chess_bitbase *bb, const char *path) {
+	bb->data = NULL;
+	bb->size = 0;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	struct stat st;
+	if (fstat(fd, &st) < 0 || st.st_size != BITBASE_FILE_LEN) {
+		close(fd);
+		return -1;
+	}
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (MAP_FAILED == data)
+		return -1;
+	if (memcmp(data, BITBASE_MAGIC, BITBASE_MAGIC_LEN) != 0) {
+		munmap(data, st.st_size);
+		return -1;
+	}
+	bb->data = data;
+	bb->size = st.st_size;
+	return 0;
+}
+
+static int table_of(chess_p p) {
+	switch (p) {
+		case PAWN:
+			return 0;
+		case ROOK:
+			return 1;
+		case QUEEN:
+			return 2;
+		default:
+			return -1;
+	}
+}
+
+/*
+ * returns the result for the side to move with perfect play, or
+ * CHESS_WDL_NONE if the material on the board isn't covered
+ */
+chess_wdl chess_bitbase_probe(const chess_bitbase *bb, const chess_t *chess) {
+	if (NULL == bb->data)
+		return CHESS_WDL_NONE;
+	color strong = NOCOLOR;
+	chess_p piece = BLANK;
+	for (int c = 0; c < 2; ++c) {
+		for (int p = 0; p < CHESS_NUM_PIECES; ++p) {
+			if (KING == p || 0 == chess->pieces[c][p])
+				continue;
+			// more than one piece besides the kings
+			if (NOCOLOR != strong || __builtin_popcountll(chess->pieces[c][p]) > 1)
+				return CHESS_WDL_NONE;
+			strong = c;
+			piece = p;
+		}
+	}
+	if (NOCOLOR == strong)
+		return CHESS_WDL_DRAW;
+	int t = table_of(piece);
+	if (t < 0)
+		return CHESS_WDL_NONE;
+	int sk = __builtin_ctzll(chess->pieces[strong][KING]);
+	int wk = __builtin_ctzll(chess->pieces[swith(strong)][KING]);
+	int ps = __builtin_ctzll(chess->pieces[strong][piece]);
+	if (BLACK == strong) {
+		// flip the board over so the strong side plays up it like white
+		int flip = (BOARD_HEIGHT - 1) * BOARD_LENGTH;
+		sk ^= flip;
+		wk ^= flip;
+		ps ^= flip;
+	}
+	int to_move = (chess->turn == strong) ? 0 : 1;
+	int i = bitbase_index(to_move, sk, wk, ps);
+	const unsigned char *table = bb->data + BITBASE_MAGIC_LEN + t * BITBASE_TABLE_LEN;
+	if (!(table[i / 8] >> (i % 8) & 1))
+		return CHESS_WDL_DRAW;
+	return (0 == to_move) ? CHESS_WDL_WIN : CHESS_WDL_LOSS;
+}
+
+void chess_bitbase_close(chess_bitbase *bb) {
+	if (NULL != bb->data)
+		munmap((void *) bb->data, bb->size);
+	bb->data = NULL;
+	bb->size = 0;
+}
@@ -0,0 +1,153 @@
+#include "book.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint64_t read_be(const unsigned char *p, int bytes) {
+	uint64_t ret = 0;
+	for (int i = 0; i < bytes; ++i)
+		ret = (ret << 8) | p[i];
+	return ret;
+}
+
+static uint64_t entry_key(const chess_book *book, size_t i) {
+	return read_be(book->data + i * CHESS_BOOK_ENTRY, 8);
+}
+
+// returns 0 on success, -1 if the file can't be mapped
+int chess_book_open(chess_book *book, const char *path) {
+	book->data = NULL;
+	book->size = 0;
+	book->entries = 0;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	struct stat st;
+	if (fstat(fd, &st) < 0 || st.st_size < CHESS_BOOK_ENTRY) {
+		close(fd);
+		return -1;
+	}
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	// the mapping keeps the file open for us
+	close(fd);
+	if (MAP_FAILED == data)
+		return -1;
+	book->data = data;
+	book->size = st.st_size;
+	book->entries = st.st_size / CHESS_BOOK_ENTRY;
+	return 0;
+}
+
+static int pack_promotion(chess_p p) {
+	switch (p) {
+		case KNIGHT:
+			return 1;
+		case BISHOP:
+			return 2;
+		case ROOK:
+			return 3;
+		case QUEEN:
+			return 4;
+		default:
+			return 0;
+	}
+}
+
+static chess_p unpack_promotion(int p) {
+	switch (p) {
+		case 1:
+			return KNIGHT;
+		case 2:
+			return BISHOP;
+		case 3:
+			return ROOK;
+		case 4:
+			return QUEEN;
+		default:
+			return BLANK;
+	}
+}
+
+/*
+ * fills out with up to max of the book's moves for this position and
+ * returns how many were found, 0 if the position is out of book
+ */
+size_t chess_book_probe(const chess_book *book, const chess_t *chess, chess_book_move *out, size_t max) {
+	// find the first entry with this position's hash
+	size_t lo = 0, hi = book->entries;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (entry_key(book, mid) < chess->hash)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	size_t n = 0;
+	for (size_t i = lo; i < book->entries && n < max && entry_key(book, i) == chess->hash; ++i) {
+		const unsigned char *e = book->data + i * CHESS_BOOK_ENTRY;
+		int m = read_be(e + 8, 2);
+		out[n].tx = m & 7;
+		out[n].ty = BOARD_HEIGHT - 1 - ((m >> 3) & 7);
+		out[n].x = (m >> 6) & 7;
+		out[n].y = BOARD_HEIGHT - 1 - ((m >> 9) & 7);
+		out[n].promote = unpack_promotion((m >> 12) & 7);
+		out[n].weight = read_be(e + 10, 2);
+		n++;
+	}
+	return n;
+}
+
+/*
+ * packs m, a move in the position chess is in, the way a book stores it.
+ * a castle becomes the king taking its own rook
+ */
+uint16_t chess_book_pack(const chess_t *chess, const chess_move *m) {
+	int tx = m->tx;
+	if (KING == chess->b[m->y][m->x].pi && abs(m->tx - m->x) == 2)
+		tx = (m->tx > m->x) ? BOARD_LENGTH - 1 : 0;
+	return tx | (BOARD_HEIGHT - 1 - m->ty) << 3 | m->x << 6 | (BOARD_HEIGHT - 1 - m->y) << 9
+		| pack_promotion(m->promote) << 12;
+}
+
+// writes a book entry for a position's hash and a packed move, weights over 0xffff are cut down to it
+void chess_book_entry(uint64_t hash, uint16_t move, unsigned int weight, unsigned char out[CHESS_BOOK_ENTRY]) {
+	if (weight > 0xffff)
+		weight = 0xffff;
+	for (int i = 0; i < 8; ++i)
+		out[i] = hash >> (56 - 8 * i);
+	out[8] = move >> 8;
+	out[9] = move;
+	out[10] = weight >> 8;
+	out[11] = weight;
+	// the learning data
+	memset(out + 12, 0, 4);
+}
+
+/*
+ * writes a book move out as notation move() accepts, always giving the
+ * origin square so it never has to be disambiguated. returns its length.
+ */
+size_t chess_book_san(const chess_t *chess, const chess_book_move *m, char buf[8]) {
+	static const char letters[] = "\0RNBQK";
+	chess_piece p = chess->b[m->y][m->x];
+	if (KING == p.pi && ROOK == chess->b[m->ty][m->tx].pi && p.c == chess->b[m->ty][m->tx].c)
+		return snprintf(buf, 8, "%s", (m->tx < m->x) ? "O-O-O" : "O-O");
+	char piece[2] = { (p.pi > PAWN) ? letters[p.pi] : '\0', '\0' };
+	char promote[2] = { (m->promote > PAWN) ? letters[m->promote] : '\0', '\0' };
+	return snprintf(buf, 8, "%s%c%c%c%c%s", piece,
+			'a' + m->x, '0' + BOARD_HEIGHT - m->y,
+			'a' + m->tx, '0' + BOARD_HEIGHT - m->ty, promote);
+}
+
+void chess_book_close(chess_book *book) {
+	if (NULL != book->data)
+		munmap((void *) book->data, book->size);
+	book->data = NULL;
+	book->size = 0;
+	book->entries = 0;
+}
@@ -1,6 +1,13 @@
 #include "chess.h"
+#include "chess_tables.h"
 #include <stdbool.h>
+#include <stdint.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <unistd.h>
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -21,11 +28,104 @@ typedef enum {
 
 typedef struct {
 	int x, y, tx, ty;
-	chess_p piece;
+	chess_p piece, promote;
 	move_flags flags;
 } move_t;
 
+// the longest a move gets in SAN, Qa1xb2Q+, with a space after it
+#define SAN_MAX 10
+// what a move number adds to its digits, "... "
+#define NUM_MAX 5
+#define ARENA_BLOCK 4096
+#define ARENA_PLIES 64
+#define GAME_MAGIC "CHESSGM1"
+#define GAME_MAGIC_LEN 8
+
+typedef struct arena_block {
+	struct arena_block *next;
+	size_t used, size;
+	max_align_t data[];
+} arena_block;
+
+// a move as it was played, and what it takes to play it backwards
+typedef struct {
+	move_t move;
+	chess_return result;
+	// whatever stood on the target square, phantom pawns included
+	chess_piece taken;
+	// the phantom pawn's square before the move, -1 if there was none
+	int8_t ep;
+	int8_t kpos[2];
+	castle_state castle;
+	color check;
+	unsigned int halfmoves;
+	uint64_t hash;
+} ply_t;
+
+/*
+ * the legal targets of each piece, kept between moves. a piece's entry
+ * holds while none of the squares in its deps change: the ones it moves
+ * through, its own, its king's, and the king's ray through it if it could
+ * be pinned. it describes the position with this hash, as if the piece's
+ * side were to move
+ */
+struct move_cache {
+	uint64_t hash;
+	uint64_t valid[2];
+	uint64_t targets[2][BOARD_LENGTH * BOARD_HEIGHT];
+	uint64_t deps[2][BOARD_LENGTH * BOARD_HEIGHT];
+};
+
+/*
+ * everything a game allocates as it goes. the blocks are only given back
+ * when the game starts over or is cleaned up, so nothing in here is ever
+ * freed or grown on its own
+ */
+struct chess_arena {
+	arena_block *blocks;
+	// the position the game started from and the moves played since. the
+	// ones from n_plies up to end_plies were taken back and can be redone
+	chess_t start;
+	ply_t *plies;
+	unsigned int n_plies, end_plies, cap_plies;
+	// the history as far as it has been written out, and the position it reached
+	char *history;
+	size_t h_cap, h_len;
+	unsigned int h_plies;
+	chess_t h_pos;
+	// the position every k_checks plies, for the plies up to end_plies
+	chess_checkpoint *checks;
+	unsigned int n_checks, cap_checks, k_checks;
+	struct move_cache cache;
+	// the pool the game came from, NULL if it was reset() on its own
+	chess_pool *pool;
+};
+
+// a game as the pool hands it out, followed by its first arena block
+typedef struct pool_slot {
+	struct pool_slot *next;
+	chess_t chess;
+	struct chess_arena arena;
+} pool_slot;
+
+#define POOL_SLAB 64
+#define POOL_LISTS 16
+#define SLOT_HEAD ((sizeof(pool_slot) + sizeof(max_align_t) - 1) / sizeof(max_align_t) * sizeof(max_align_t))
+#define SLOT_SIZE (SLOT_HEAD + sizeof(arena_block) + ARENA_BLOCK)
+
+struct chess_pool {
+	// threads take turns at the lists, so each one usually has its own
+	struct {
+		pthread_mutex_t lock;
+		pool_slot *free;
+	} lists[POOL_LISTS];
+	pthread_mutex_t slab_lock;
+	void **slabs;
+	size_t n_slabs;
+};
+
 static void print_piece(chess_piece);
+static chess_return play(chess_t *, move_t *);
 static void rm_phantoms(board, int, int);
 
 //static int abs(int in) {
@@ -40,7 +140,8 @@ static bool out_of_bounds(int x, int y) {
 static bool _move(board b, int x, int y, int tx, int ty) {
 	int behind = ((y < ty) ? -1 : 1);
 	chess_piece piece = b[y][x], prev = b[ty][tx];
-	bool ret = prev.pi != BLANK;
+	// a phantom pawn is only there to be taken by a pawn
+	bool ret = prev.pi >= PAWN || (prev.pi == F_PAWN && piece.pi == PAWN);
 	b[ty][tx] = piece;
 	b[y][x].pi = BLANK;
 	b[y][x].c = WHITE;
@@ -54,7 +155,9 @@ static bool _move(board b, int x, int y, int tx, int ty) {
 			b[ty + behind][tx].c = WHITE;
 		}
 	}
-	rm_phantoms(b, tx, ty + behind);
+	// only a phantom this move made survives it
+	bool jumped = piece.pi == PAWN && abs(y - ty) == 2;
+	rm_phantoms(b, tx, jumped ? ty + behind : -1);
 	return ret;
 }
 
@@ -65,7 +168,8 @@ static bool check_line(const board b, int fromx, int fromy, int tox, int toy) {
 	fromy += (fromy == toy) ? 0 : ((fromy < toy) ? 1 : -1);
 	if (fromx == tox && fromy == toy) 
 		return true;
-	if (b[fromy][fromx].pi != BLANK)
+	// phantom pawns mark an empty square
+	if (b[fromy][fromx].pi >= PAWN)
 		return false;
 	return check_line(b, fromx, fromy, tox, toy);
 }
@@ -240,18 +344,118 @@ static void print_piece(chess_piece piece) {
 #undef fff_print
 }
 
-static bool incheck(board b, int kx, int ky) {
-	for (int i = 0; i < BOARD_HEIGHT; i++) {
-		for (int j = 0; j < BOARD_LENGTH; j++) {
-			if (can_move(b, j, i, kx, ky))
-				return true;
-		}
+#define NOT_A_FILE 0xfefefefefefefefeULL
+#define NOT_H_FILE 0x7f7f7f7f7f7f7f7fULL
+
+// king_dirs as shifts of the square number, and the file a shift can't wrap onto
+static const int fill_shift[8] = { 8, 9, 1, -7, -8, -9, -1, 7 };
+static const uint64_t fill_mask[8] = {
+	~0ULL, NOT_A_FILE, NOT_A_FILE, NOT_A_FILE, ~0ULL, NOT_H_FILE, NOT_H_FILE, NOT_H_FILE
+};
+
+static uint64_t shift(uint64_t b, int s) {
+	return (s > 0) ? b << s : b >> -s;
+}
+
+/*
+ * kogge-stone fills: every square the pieces in rooks reach along rook
+ * lines and the pieces in bishops reach along bishop lines, up to and
+ * including the first square that isn't in empty
+ */
+static uint64_t slider_attacks_scalar(uint64_t rooks, uint64_t bishops, uint64_t empty) {
+	uint64_t ret = 0;
+	for (int i = 0; i < 8; ++i) {
+		int s = fill_shift[i];
+		uint64_t gen = (i % 2) ? bishops : rooks;
+		uint64_t pro = empty & fill_mask[i];
+		gen |= pro & shift(gen, s);
+		pro &= shift(pro, s);
+		gen |= pro & shift(gen, 2 * s);
+		pro &= shift(pro, 2 * s);
+		gen |= pro & shift(gen, 4 * s);
+		ret |= shift(gen, s) & fill_mask[i];
 	}
-	return false;
+	return ret;
+}
+
+#ifdef __x86_64__
+// the same fills four directions at a time, the ones shifting up in one vector and down in the other
+__attribute__((target("avx2")))
+static uint64_t slider_attacks_avx2(uint64_t rooks, uint64_t bishops, uint64_t empty) {
+	const __m256i gen0 = _mm256_setr_epi64x(rooks, bishops, rooks, bishops);
+	const __m256i shifts = _mm256_setr_epi64x(8, 9, 1, 7);
+	const __m256i up_mask = _mm256_setr_epi64x(~0ULL, NOT_A_FILE, NOT_A_FILE, NOT_H_FILE);
+	const __m256i down_mask = _mm256_setr_epi64x(~0ULL, NOT_H_FILE, NOT_H_FILE, NOT_A_FILE);
+	const __m256i e = _mm256_set1_epi64x(empty);
+
+	__m256i gen = gen0, pro = _mm256_and_si256(e, up_mask);
+	__m256i s = shifts;
+	for (int i = 0; i < 2; ++i) {
+		gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_sllv_epi64(gen, s)));
+		pro = _mm256_and_si256(pro, _mm256_sllv_epi64(pro, s));
+		s = _mm256_add_epi64(s, s);
+	}
+	gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_sllv_epi64(gen, s)));
+	__m256i att = _mm256_and_si256(_mm256_sllv_epi64(gen, shifts), up_mask);
+
+	gen = gen0;
+	pro = _mm256_and_si256(e, down_mask);
+	s = shifts;
+	for (int i = 0; i < 2; ++i) {
+		gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_srlv_epi64(gen, s)));
+		pro = _mm256_and_si256(pro, _mm256_srlv_epi64(pro, s));
+		s = _mm256_add_epi64(s, s);
+	}
+	gen = _mm256_or_si256(gen, _mm256_and_si256(pro, _mm256_srlv_epi64(gen, s)));
+	att = _mm256_or_si256(att, _mm256_and_si256(_mm256_srlv_epi64(gen, shifts), down_mask));
+
+	__m128i half = _mm_or_si128(_mm256_castsi256_si128(att), _mm256_extracti128_si256(att, 1));
+	return _mm_cvtsi128_si64(half) | _mm_extract_epi64(half, 1);
+}
+#endif
+
+static uint64_t (*slider_attacks)(uint64_t, uint64_t, uint64_t) = slider_attacks_scalar;
+
+// picks the widest fill the processor can run, once at startup
+__attribute__((constructor))
+static void pick_slider_attacks(void) {
+#ifdef __x86_64__
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		slider_attacks = slider_attacks_avx2;
+#endif
+}
+
+static uint64_t occupancy(const uint64_t sets[2][CHESS_NUM_PIECES]) {
+	uint64_t ret = 0;
+	for (int p = 0; p < CHESS_NUM_PIECES; ++p)
+		ret |= sets[WHITE][p] | sets[BLACK][p];
+	return ret;
+}
+
+// true if the king of color c is attacked, going by the piece sets alone
+static bool incheck(const uint64_t sets[2][CHESS_NUM_PIECES], color c) {
+	color by = swith(c);
+	int ksq = __builtin_ctzll(sets[c][KING]);
+	for (int i = 0; i < 2; ++i)
+		if (pawn_take[c][ksq][i] >= 0 && (sets[by][PAWN] >> pawn_take[c][ksq][i] & 1))
+			return true;
+	for (const int8_t *t = horse_sq[ksq]; *t >= 0; ++t)
+		if (sets[by][KNIGHT] >> *t & 1)
+			return true;
+	for (const int8_t *t = king_sq[ksq]; *t >= 0; ++t)
+		if (sets[by][KING] >> *t & 1)
+			return true;
+	uint64_t rooks = sets[by][ROOK] | sets[by][QUEEN];
+	uint64_t bishops = sets[by][BISHOP] | sets[by][QUEEN];
+	return slider_attacks(rooks, bishops, ~occupancy(sets)) & sets[c][KING];
 }
 
 static void rm_phantoms(board b, int x, int y) {
-	for (int i = 0; i < BOARD_HEIGHT; i++) {
+	// a phantom only ever stands where a pawn jumped over, see ep_square()
+	static const int ranks[2] = { 2, BOARD_HEIGHT - 3 };
+	for (int r = 0; r < 2; r++) {
+		int i = ranks[r];
 		for (int j = 0; j < BOARD_LENGTH; j++) {
 			if (j == x && i == y) continue;
 			if (b[i][j].pi == F_PAWN) {
@@ -259,52 +463,47 @@ static void rm_phantoms(board b, int x, int y) {
 				b[i][j].c = WHITE;
 			}
 		}
-	}	
-
+	}
 }
 
 /*
  * returns true if it can keep going, false otherwise
  */
-static bool pawn_movement(board b, int sign, int x, int y, int *tx, int *ty, int *iterations) {
+static bool pawn_movement(board b, color c, int x, int y, int *tx, int *ty, int *iterations) {
+	int sq = y * BOARD_LENGTH + x;
+	int t;
 	switch (*iterations) {
 		case -1:
 			return false;
 		case 0:
-			*tx = x;
-			*ty = y + sign;
+			t = pawn_push[c][sq];
 			break;
 		case 1:
-			*tx = x - 1;
-			*ty = y + sign;
-			break;
 		case 2:
-			*tx = x + 1;
-			*ty = y + sign;
+			t = pawn_take[c][sq][*iterations - 1];
 			break;
 		case 3:
-			if (x != (BOARD_HEIGHT + sign - 1) % 7)
-				return false;
-			*tx = x;
-			*ty = y + 2 * sign;
+			t = pawn_double[c][sq];
 			break;
 		default:
 			*iterations = -1;
 			return false;
 	}
 	*iterations = *iterations + 1;
+	if (t < 0)
+		return false;
+	*tx = t % BOARD_LENGTH;
+	*ty = t / BOARD_LENGTH;
 	return can_move_minimal(b, x, y, *tx, *ty);
 }
 
-static bool diag_movement(board b, int dir, int x, int y, int *tx, int *ty, int *iterations) {
-	if (dir > 3 || dir < 0 || *iterations < 0) {
-		*iterations = -1;
+// walks one square further along ray dir (an index into king_dirs) each call
+static bool ray_movement(board b, int dir, int x, int y, int *tx, int *ty, int *iterations) {
+	int t = ray_sq[dir][y * BOARD_LENGTH + x][*iterations];
+	if (t < 0)
 		return false;
-	}
-	int xdir = (dir / 2) * 2 - 1;
-	int ydir = (((dir + 1) % 4) / 2) * 2 - 1;
-	*tx = x + (*iterations + 1) * xdir;
-	*ty = y + (*iterations + 1) * ydir;
+	*tx = t % BOARD_LENGTH;
+	*ty = t / BOARD_LENGTH;
 	if (!can_move_minimal(b, x, y, *tx, *ty)) {
 		return false;
 	}
@@ -312,58 +511,34 @@ static bool diag_movement(board b, int dir, int x, int y, int *tx, int *ty, int
 	return true;
 }
 
-static bool cross_movement(board b, int dir, int x, int y, int *tx, int *ty, int *iterations) {
+static bool diag_movement(board b, int dir, int x, int y, int *tx, int *ty, int *iterations) {
 	if (dir > 3 || dir < 0 || *iterations < 0) {
 		*iterations = -1;
 		return false;
 	}
-	int xdir, ydir;
-	switch (dir) {
-		case 0:	// up
-			xdir = 0;
-			ydir = 1;
-			break;
-		case 1:	// right
-			xdir = 1;
-			ydir = 0;
-			break;
-		case 2:	// down 
-			xdir = 0;
-			ydir = -1;
-			break;
-		case 3:	// left
-			xdir = -1;
-			ydir = 0;
-			break;
-		default:
-			*iterations = -1;
-			return false;
-	}
-	*tx = x + xdir * (*iterations + 1);
-	*ty = y + ydir * (*iterations + 1);
-	if (!can_move_minimal(b, x, y, *tx, *ty)) {
+	// the diagonals are the odd directions
+	return ray_movement(b, dir * 2 + 1, x, y, tx, ty, iterations);
+}
+
+static bool cross_movement(board b, int dir, int x, int y, int *tx, int *ty, int *iterations) {
+	if (dir > 3 || dir < 0 || *iterations < 0) {
+		*iterations = -1;
 		return false;
 	}
-	*iterations = *iterations + 1;
-	return true;
+	// up, right, down and left are the even directions
+	return ray_movement(b, dir * 2, x, y, tx, ty, iterations);
 }
 
-static bool horse_movement(board b, int dir, int x, int y, int *tx, int *ty, int *iterations) {
-	if (*iterations > 7 || *iterations < 0) {
+static bool horse_movement(board b, int x, int y, int *tx, int *ty, int *iterations) {
+	int t = (*iterations < 0) ? -1 : horse_sq[y * BOARD_LENGTH + x][*iterations];
+	if (t < 0) {
 		*iterations = -1;
 		return false;
 	}
-	int i = *iterations;
-	int ydir = (((i / 4) * -2) + 1) * ((((i % 2) + (i / 2)) % 2) + 1);
-	i = (*iterations + 2) % 8;
-	int xdir = (((i / 4) * -2) + 1) * ((((i % 2) + (i / 2)) % 2) + 1);
-	*tx = x + xdir;
-	*ty = y + ydir;
+	*tx = t % BOARD_LENGTH;
+	*ty = t / BOARD_LENGTH;
 	*iterations = *iterations + 1;
-	if (!can_move_minimal(b, x, y, *tx, *ty)) {
-		return false;
-	}
-	return true;
+	return can_move_minimal(b, x, y, *tx, *ty);
 }
 
 /*
@@ -373,13 +548,12 @@ static bool check_piece_movement(board b, chess_piece p, int *dir, int x, int y,
 	bool ret = false;
 	switch (p.pi) {
 		case PAWN:
-			int sign = (p.c == WHITE) ? -1 : 1;
-			return pawn_movement(b, sign, x, y, tx, ty, iterations);
+			return pawn_movement(b, p.c, x, y, tx, ty, iterations);
 		case ROOK:
 			ret = cross_movement(b, *dir, x, y, tx, ty, iterations);
 			break;
 		case KNIGHT:
-			ret = horse_movement(b, *dir, x, y, tx, ty, iterations);
+			ret = horse_movement(b, x, y, tx, ty, iterations);
 			break;
 		case BISHOP:
 			ret = diag_movement(b, *dir, x, y, tx, ty, iterations);
@@ -415,28 +589,6 @@ static bool check_piece_movement(board b, chess_piece p, int *dir, int x, int y,
 	return ret;
 }
 
-static bool all_movements(board b, board tmp, int x, int y, int kx, int ky) {
-	int iterations = 0;
-	int dir = 0;
-	while (1) {
-		int tx, ty;
-		chess_piece p = b[y][x];
-		while (!check_piece_movement(b, p, &dir, x, y, &tx, &ty, &iterations) && 
-				iterations >= 0);
-		if (iterations < 0)
-			return false;
-		memcpy(*tmp, *b, sizeof(board));
-		_move(tmp, x, y, tx, ty);
-		int tkx = kx, tky = ky;
-		if (KING == p.pi) {
-			tkx = tx;
-			tky = ty;
-		}
-		if (!incheck(tmp, tkx, tky))
-			return true;
-	}
-}
-
 static size_t what_can_attack_me(board b, color turn, int x, int y, int enemies[16][2]) {
 	size_t e = 0;
 	// check for pawns
@@ -497,92 +649,216 @@ static size_t what_can_attack_me(board b, color turn, int x, int y, int enemies[
 			enemies[e][1] = ty;
 			e++;
 		}
+		if (found >= PAWN) {
+			// nothing sees through the first piece on a line, move on to the next one
+			iterations = 0;
+			dir++;
+		}
 	} while (iterations >= 0);
 	return e;
 }
 
-static void iterate_line(int *x, int *y, int tx, int ty, int iterations) {
-	if (*x == tx && *y == ty)
-		return;
-	if (*x != tx)
-		*x += (*x > tx ? -1 : 1) * iterations;
-	if (*y != ty)
-		*y += (*y > ty ? -1 : 1) * iterations;
+#define sq_bit(x, y) (1ULL << ((y) * BOARD_LENGTH + (x)))
+
+// phantom pawns don't block anything, they only mark en passant targets
+static bool occupied(const board b, int x, int y) {
+	return b[y][x].pi >= PAWN;
+}
+
+// true if square sq holds a piece of color c and type p
+static bool holds(const board b, int sq, color c, chess_p p) {
+	chess_piece at = b[sq / BOARD_LENGTH][sq % BOARD_LENGTH];
+	return at.pi == p && at.c == c;
 }
 
-static bool try_check(board b, board tmp, int x, int y, int tx, int ty, int kx, int ky) {
-	if (kx == x && ky == y) {
-		kx = tx;
-		ky = ty;
+/*
+ * returns true if a piece of color by attacks (x, y), treating
+ * (ix, iy) as empty so the king can't hide behind itself
+ */
+static bool attacked(const board b, color by, int x, int y, int ix, int iy) {
+	int sq = y * BOARD_LENGTH + x;
+	// a pawn of color by attacks (x, y) from where the other color's pawn would take
+	for (int i = 0; i < 2; ++i)
+		if (pawn_take[swith(by)][sq][i] >= 0 && holds(b, pawn_take[swith(by)][sq][i], by, PAWN))
+			return true;
+	for (const int8_t *t = horse_sq[sq]; *t >= 0; ++t)
+		if (holds(b, *t, by, KNIGHT))
+			return true;
+	for (const int8_t *t = king_sq[sq]; *t >= 0; ++t)
+		if (holds(b, *t, by, KING))
+			return true;
+	int ignored = (ix < 0) ? -1 : iy * BOARD_LENGTH + ix;
+	for (int i = 0; i < 8; ++i) {
+		// even directions are rook lines, odd directions are bishop lines
+		chess_p slider = (i % 2 == 0) ? ROOK : BISHOP;
+		for (const int8_t *t = ray_sq[i][sq]; *t >= 0; ++t) {
+			if (*t == ignored || !occupied(b, *t % BOARD_LENGTH, *t / BOARD_LENGTH))
+				continue;
+			if (holds(b, *t, by, slider) || holds(b, *t, by, QUEEN))
+				return true;
+			break;
+		}
 	}
-	if (!can_move(b, x, y, tx, ty))
+	return false;
+}
+
+/*
+ * en passant is the one move that clears a square off of the moving piece's
+ * line, so rather than reasoning about it, play it out in place and undo it
+ */
+static bool en_passant_legal(board b, color turn, int x, int y, int tx, int ty, int kx, int ky) {
+	chess_piece pawn = b[y][x], taken = b[y][tx], phantom = b[ty][tx];
+	b[ty][tx] = pawn;
+	b[y][x] = (chess_piece) { .pi = BLANK, .c = WHITE };
+	b[y][tx] = (chess_piece) { .pi = BLANK, .c = WHITE };
+	bool ret = !attacked(b, swith(turn), kx, ky, -1, -1);
+	b[y][x] = pawn;
+	b[y][tx] = taken;
+	b[ty][tx] = phantom;
+	return ret;
+}
+
+/*
+ * returns true if a piece of color turn is allowed to land on (tx, ty), given the
+ * squares that resolve a check and the line it is pinned to (dx = dy = 0 if it isn't)
+ */
+static bool lands_legally(uint64_t evasions, int pin[2], int kx, int ky, int tx, int ty) {
+	if (!(evasions & sq_bit(tx, ty)))
+		return false;
+	if (0 == pin[0] && 0 == pin[1])
 		return true;
-	memcpy(*tmp, *b, sizeof(board));
-	_move(tmp, x, y, tx, ty);
-	return incheck(tmp, kx, ky);
+	// a pinned piece may only slide along the line through its king
+	int ox = tx - kx, oy = ty - ky;
+	return ox * pin[1] == oy * pin[0] && ox * pin[0] + oy * pin[1] > 0;
 }
 
-static bool legal_move_exists(board b, color turn, int kx, int ky, bool check) {
-	board tmp;
-	if (check) {
-		// check all of the king's movements if they get him out of check
-		if (all_movements(b, tmp, kx, ky, kx, ky))
-			return true;
-		// That didn't work, find out what is putting the king in check
-		int enemigos[16][2];
-		size_t q_enemigos = what_can_attack_me(b, turn, kx, ky, enemigos);
-		// since we know the layout of enemigos, we can check the pawns and knights first
-		// the only way to stop a pawn or knight is by capturing them, so 
-		// see if any of our pieces can take one of these pieces
-		// may as well check all the other ones as well
-		for (int y = 0; y < BOARD_HEIGHT; ++y) {
-			for (int x = 0; x < BOARD_LENGTH; ++x) {
-				if (BLANK == b[y][x].pi)
+static bool piece_has_move(board b, color turn, int x, int y, int kx, int ky, uint64_t evasions, int pin[2]) {
+	chess_piece p = b[y][x];
+	int sq = y * BOARD_LENGTH + x;
+	switch (p.pi) {
+		case PAWN: {
+			int t = pawn_push[turn][sq];
+			if (t < 0)
+				return false;
+			int ty = t / BOARD_LENGTH;
+			if (!occupied(b, x, ty)) {
+				if (lands_legally(evasions, pin, kx, ky, x, ty))
+					return true;
+				t = pawn_double[turn][sq];
+				if (t >= 0 && !occupied(b, x, t / BOARD_LENGTH) &&
+						lands_legally(evasions, pin, kx, ky, x, t / BOARD_LENGTH))
+					return true;
+			}
+			for (int i = 0; i < 2; ++i) {
+				t = pawn_take[turn][sq][i];
+				if (t < 0)
 					continue;
-				if (b[y][x].c != turn)
+				int tx = t % BOARD_LENGTH;
+				if (b[ty][tx].c == turn)
 					continue;
-				for (int i = 0; i < q_enemigos; ++i) {
-					// see if it can take any of the enemigos
-					// if it can, see if we're still in check
-					if (!try_check(b, tmp, x, y, enemigos[i][0], enemigos[i][1], kx, ky))
+				if (F_PAWN == b[ty][tx].pi) {
+					if (en_passant_legal(b, turn, x, y, tx, ty, kx, ky))
 						return true;
-					// better luck next time
+				} else if (occupied(b, tx, ty) && lands_legally(evasions, pin, kx, ky, tx, ty)) {
+					return true;
 				}
 			}
+			return false;
 		}
-		// no luck, try and block one of the enemigos instead
-		for (int i = 0; i < q_enemigos; ++i) {
-			int tx = enemigos[i][0];
-			int ty = enemigos[i][1];
-			if (KNIGHT == b[ty][tx].pi || PAWN == b[ty][tx].pi)
-				// skip pawns and knights that can't be blocked
-				continue;
-			for (int y = 0; y < BOARD_HEIGHT; ++y) {
-				for (int x = 0; x < BOARD_LENGTH; ++x) {
-					if (BLANK == b[y][x].pi)
-						continue;
-					if (b[y][x].c != turn)
-						continue;
-					int tmpy = y;
-					int tmpx = x;
-					int iterations = 1;
-					do {
-						iterate_line(&tmpx, &tmpy, tx, ty, iterations++);
-						if (!try_check(b, tmp, x, y, tmpx, tmpy, kx, ky))
-							return true;
-					} while (tmpy != ty && tmpx != tx && !out_of_bounds(tmpx, tmpy));
+		case KNIGHT:
+			// a pinned knight can never stay on its line
+			if (pin[0] || pin[1])
+				return false;
+			for (const int8_t *t = horse_sq[sq]; *t >= 0; ++t) {
+				int tx = *t % BOARD_LENGTH, ty = *t / BOARD_LENGTH;
+				if (occupied(b, tx, ty) && b[ty][tx].c == turn)
+					continue;
+				if (evasions & sq_bit(tx, ty))
+					return true;
+			}
+			return false;
+		case ROOK:
+		case BISHOP:
+		case QUEEN:
+			for (int i = 0; i < 8; ++i) {
+				if ((ROOK == p.pi && i % 2) || (BISHOP == p.pi && i % 2 == 0))
+					continue;
+				for (const int8_t *t = ray_sq[i][sq]; *t >= 0; ++t) {
+					int tx = *t % BOARD_LENGTH, ty = *t / BOARD_LENGTH;
+					bool full = occupied(b, tx, ty);
+					if (full && b[ty][tx].c == turn)
+						break;
+					if (lands_legally(evasions, pin, kx, ky, tx, ty))
+						return true;
+					if (full)
+						break;
 				}
 			}
+			return false;
+		default:
+			return false;
+	}
+}
+
+/*
+ * returns true as soon as any legal move is found for the player turn.
+ * checkers and pins are worked out once up front so each candidate move
+ * can be accepted with a mask test instead of replaying it on a copy.
+ */
+static bool legal_move_exists(board b, color turn, int kx, int ky, bool check) {
+	color enemy = swith(turn);
+	int ksq = ky * BOARD_LENGTH + kx;
+	// the king can step anywhere not covered, looking through where it stands now
+	for (const int8_t *t = king_sq[ksq]; *t >= 0; ++t) {
+		int tx = *t % BOARD_LENGTH, ty = *t / BOARD_LENGTH;
+		if (occupied(b, tx, ty) && b[ty][tx].c == turn)
+			continue;
+		if (!attacked(b, enemy, tx, ty, kx, ky))
+			return true;
+	}
+	// squares another piece must land on to deal with a check, all of them if not in check
+	uint64_t evasions = ~0ULL;
+	if (check) {
+		int enemigos[16][2];
+		size_t q_enemigos = what_can_attack_me(b, turn, kx, ky, enemigos);
+		// only the king can get out of a double check
+		if (q_enemigos > 1)
+			return false;
+		if (q_enemigos == 1) {
+			int ex = enemigos[0][0], ey = enemigos[0][1];
+			// anything in between blocks a slider, there is nothing between a knight or pawn
+			evasions = sq_bit(ex, ey) | between[ksq][ey * BOARD_LENGTH + ex];
+		}
+	}
+	// a friendly piece alone between the king and an enemy slider is pinned to that line
+	int pins[BOARD_HEIGHT][BOARD_LENGTH][2];
+	memset(pins, 0, sizeof pins);
+	for (int i = 0; i < 8; ++i) {
+		chess_p slider = (i % 2 == 0) ? ROOK : BISHOP;
+		int pinned = -1;
+		for (const int8_t *t = ray_sq[i][ksq]; *t >= 0; ++t) {
+			int tx = *t % BOARD_LENGTH, ty = *t / BOARD_LENGTH;
+			if (!occupied(b, tx, ty))
+				continue;
+			chess_piece p = b[ty][tx];
+			if (p.c == turn) {
+				if (pinned >= 0)
+					break;
+				pinned = *t;
+				continue;
+			}
+			if (pinned >= 0 && (slider == p.pi || QUEEN == p.pi)) {
+				pins[pinned / BOARD_LENGTH][pinned % BOARD_LENGTH][0] = king_dirs[i][0];
+				pins[pinned / BOARD_LENGTH][pinned % BOARD_LENGTH][1] = king_dirs[i][1];
+			}
+			break;
 		}
-		return false;
 	}
 	for (int y = 0; y < BOARD_HEIGHT; ++y) {
 		for (int x = 0; x < BOARD_LENGTH; ++x) {
-			if (BLANK == b[y][x].pi)
+			if (!occupied(b, x, y) || b[y][x].c != turn || KING == b[y][x].pi)
 				continue;
-			if (b[y][x].c != turn)
-				continue;
-			if (all_movements(b, tmp, x, y, kx, ky))
+			if (piece_has_move(b, turn, x, y, kx, ky, evasions, pins[y][x]))
 				return true;
 		}
 	}
@@ -635,14 +911,18 @@ static bool parse_flag(char flag, move_t *move) {
  * This function parses a movement string into a move type,
  * but makes no checks if the move is possible
  */
-static bool parse_movement(char *notation, color turn, move_t *move, char *promote) {
+static bool parse_movement(char *notation, color turn, move_t *move) {
 	size_t length = strlen(notation);
 	move->flags = 0;
 	move->x = -1;
 	move->y = -1;
 	move->piece = PAWN;
-	if (parse_flag(notation[length - 1], move))
+	move->promote = BLANK;
+	if (length > 0 && parse_flag(notation[length - 1], move))
 		length--;
+	// nothing is shorter than a pawn's push
+	if (length < 2)
+		return false;
 	if (*notation == '0' || *notation == 'o' || *notation == 'O') {
 		char cch[3] = " -";
 		cch[0] = *notation;
@@ -665,10 +945,9 @@ static bool parse_movement(char *notation, color turn, move_t *move, char *promo
 
 	char *dest = notation + (length - 2);
 	char *disambig = notation;
-	promote = NULL;
 
-	if (isupper(dest[1])) {	// promoting a pawn
-		promote = dest + 1;
+	if (isupper(dest[1]) && dest > notation) {	// promoting a pawn
+		move->promote = parse_piece(dest[1]);
 		dest--;
 		move->flags |= MOVE_PROMOTE;
 	}
@@ -688,58 +967,140 @@ static bool parse_movement(char *notation, color turn, move_t *move, char *promo
 	return true;
 }
 
+// makes the piece sets agree with whatever is now on (x, y) in the board
+// and keeps the position hash in step with them
+static void sync_square(chess_t *chess, int x, int y) {
+	int sq = y * BOARD_LENGTH + x;
+	uint64_t bit = sq_bit(x, y);
+	for (int c = 0; c < 2; ++c) {
+		for (int p = 0; p < CHESS_NUM_PIECES; ++p) {
+			if (!(chess->pieces[c][p] & bit))
+				continue;
+			chess->pieces[c][p] &= ~bit;
+			chess->hash ^= zobrist_pieces[c][p][sq];
+		}
+	}
+	chess_piece p = chess->b[y][x];
+	if (p.pi >= PAWN) {
+		chess->pieces[p.c][p.pi] |= bit;
+		chess->hash ^= zobrist_pieces[p.c][p.pi][sq];
+	}
+}
+
+// the square a pawn can be taken en passant on, -1 if there is none
+static int ep_square(const board b) {
+	for (int x = 0; x < BOARD_LENGTH; ++x) {
+		if (F_PAWN == b[2][x].pi)
+			return 2 * BOARD_LENGTH + x;
+		if (F_PAWN == b[BOARD_HEIGHT - 3][x].pi)
+			return (BOARD_HEIGHT - 3) * BOARD_LENGTH + x;
+	}
+	return -1;
+}
+
+/*
+ * true if (x, y) can take the phantom pawn of the side that just moved,
+ * turn being the side to move: the empty square on the third rank of that
+ * side, with its pawn in front of it and the square it jumped from empty
+ */
+static bool ep_allowed(const board b, color turn, int x, int y) {
+	color by = swith(turn);
+	// the way the other side's pawns move, white's towards y = 0
+	int dir = (WHITE == by) ? -1 : 1;
+	if (out_of_bounds(x, y) || y != ((WHITE == turn) ? 2 : BOARD_HEIGHT - 3))
+		return false;
+	chess_piece front = b[y + dir][x];
+	return BLANK == b[y][x].pi && BLANK == b[y - dir][x].pi && PAWN == front.pi && by == front.c;
+}
+
+static int ep_file(const board b) {
+	int sq = ep_square(b);
+	return (sq < 0) ? -1 : sq % BOARD_LENGTH;
+}
+
+static uint64_t castle_hash(castle_state castle) {
+	uint64_t ret = 0;
+	for (int i = 0; i < 4; ++i)
+		if (castle & (1 << i))
+			ret ^= zobrist_castle[i];
+	return ret;
+}
+
+// the piece sets once move is made, going by the squares it touched on buf
+static void sets_after(const chess_t *chess, const move_t *move, const board buf, uint64_t after[2][CHESS_NUM_PIECES]) {
+	memcpy(after, chess->pieces, sizeof chess->pieces);
+	int touched[7][2] = {
+		{ move->x, move->y }, { move->tx, move->ty }, { move->tx, move->y },
+		{ 0, move->y }, { 3, move->y }, { BOARD_LENGTH - 3, move->y }, { BOARD_LENGTH - 1, move->y }
+	};
+	for (int i = 0; i < ((move->flags & MOVE_CASTLE) ? 7 : 3); ++i) {
+		int x = touched[i][0], y = touched[i][1];
+		uint64_t bit = sq_bit(x, y);
+		for (int c = 0; c < 2; ++c)
+			for (int p = 0; p < CHESS_NUM_PIECES; ++p)
+				after[c][p] &= ~bit;
+		if (occupied(buf, x, y))
+			after[buf[y][x].c][buf[y][x].pi] |= bit;
+	}
+}
+
 static int find_x_y(chess_t *chess, move_t *move, bool *kind) {
+	// both squares given, there is nothing to search but the piece still has to be there
 	if (move->x > -1 && move->y > -1)
-		return 1;
+		return holds(chess->b, move->y * BOARD_LENGTH + move->x, chess->turn, move->piece) &&
+			((move->flags & MOVE_CASTLE) || can_move(chess->b, move->x, move->y, move->tx, move->ty));
 	int matches = 0;
-	for (int i = 0; i < BOARD_HEIGHT; ++i) {
-		for (int j = 0; j < BOARD_LENGTH; ++j) {
-			// check if this piece matches the piece we are trying to move
-			if (!(chess->b[i][j].pi == move->piece &&
-			      chess->b[i][j].c == chess->turn))
-				continue;
-			// check if this piece can move to the position we are trying to move to 
-			if (!can_move(chess->b, j, i, move->tx, move->ty))
-				continue;
-			// check if this piece matches given position constraints, if any were given
-			if ((move->x > -1 && j != move->x) || (move->y > -1 && i != move->y))
-				continue;
-			matches++;
-			if (kind != NULL && matches > 1 && !(matches > 2))
-				*kind = move->x == j;
-			// assume this is the right piece
-			move->x = j;
-			move->y = i;
-		}
+	// the constraints given, since move->x and move->y get overwritten with each match
+	int want_x = move->x, want_y = move->y;
+	// only visit the pieces of the right type and color, in board order
+	for (uint64_t left = chess->pieces[chess->turn][move->piece]; left; left &= left - 1) {
+		int sq = __builtin_ctzll(left);
+		int i = sq / BOARD_LENGTH;
+		int j = sq % BOARD_LENGTH;
+		// check if this piece can move to the position we are trying to move to 
+		if (!can_move(chess->b, j, i, move->tx, move->ty))
+			continue;
+		// check if this piece matches given position constraints, if any were given
+		if ((want_x > -1 && j != want_x) || (want_y > -1 && i != want_y))
+			continue;
+		matches++;
+		if (kind != NULL && matches > 1 && !(matches > 2))
+			*kind = move->x == j;
+		// assume this is the right piece
+		move->x = j;
+		move->y = i;
 	}
 	return matches;
 }
 
-static bool promotion(board b, move_t *move, char* promote) {
-	if (NULL == promote)
+static bool promotion(board b, move_t *move) {
+	if (BLANK == move->promote || PAWN == move->promote || KING == move->promote)
 		return false;
-	chess_p prom = parse_piece(*promote);
-	if (BLANK == prom)
-		return false;
-	b[move->ty][move->tx].pi = prom;
+	b[move->ty][move->tx].pi = move->promote;
 	return true;
 }
 
-static bool test_move(chess_t *chess_board, move_t *move, board buf, int kcopy[2], char *promote, castle_state *state) {
+static bool test_move(chess_t *chess_board, move_t *move, board buf, int kcopy[2], castle_state *state) {
 	castle_state col = (chess_board->turn == WHITE) ? W_CASTLE_QUEEN : B_CASTLE_QUEEN;
-	if (move->tx != 0)
+	if (move->tx > move->x)
 		col *= 2;
+	// the rook castling towards the king
+	int rx = (move->tx > move->x) ? BOARD_LENGTH - 1 : 0;
 	// one can castle if and only if
 	// 1: neither the king nor the rook castling has been moved
 	// 2: the line is clear between them
-	// 3: the king is not in check
+	// 3: the king is not in check, and doesn't pass through check
 	if ((move->flags & MOVE_CASTLE) &&
 			((chess_board->castle & col) == 0 ||
-			!check_line(chess_board->b, move->x, move->y, move->tx, move->ty) || 
-			NOCOLOR != chess_board->check))
+			ROOK != chess_board->b[move->y][rx].pi ||
+			chess_board->turn != chess_board->b[move->y][rx].c ||
+			!check_line(chess_board->b, move->x, move->y, rx, move->ty) ||
+			NOCOLOR != chess_board->check ||
+			attacked(chess_board->b, swith(chess_board->turn), (move->x + move->tx) / 2, move->y, move->x, move->y)))
 		return false;
-	if ((move->flags & MOVE_PROMOTE) && move->piece != PAWN &&
-			move->ty != (BOARD_HEIGHT - 1) * swith(chess_board->turn))
+	// pawns promote when, and only when, they reach the far rank
+	bool last_rank = move->piece == PAWN && move->ty == (BOARD_HEIGHT - 1) * chess_board->turn;
+	if (last_rank != !!(move->flags & MOVE_PROMOTE))
 		return false;
 	memcpy(*buf, *chess_board->b, sizeof chess_board->b);
 	// make the move on the temporary board
@@ -766,83 +1127,158 @@ static bool test_move(chess_t *chess_board, move_t *move, board buf, int kcopy[2
 		default:
 			break;
 	}
-	if (incheck(buf, kcopy[0], kcopy[1]))
+	uint64_t after[2][CHESS_NUM_PIECES];
+	sets_after(chess_board, move, buf, after);
+	if (incheck(after, chess_board->turn))
 		return false;
 	if (move->flags & MOVE_CASTLE) {
-		// we are castling, move the rook
-		castle_state tstate = (chess_board->turn == WHITE) ? W_CASTLE_QUEEN : B_CASTLE_QUEEN;
-		int x = (tstate == col) ? 0 : BOARD_LENGTH - 1;
-		int tx = (tstate == col) ? 3 : BOARD_LENGTH - 3;
-		_move(buf, x, move->y, tx, move->ty);
+		// we are castling, the rook lands on the square the king passed over
+		_move(buf, rx, move->y, (move->x + move->tx) / 2, move->ty);
 	}
 	*state = cstate;
 	if (move->flags & MOVE_PROMOTE)
-		return promotion(buf, move, promote);
+		return promotion(buf, move);
 	return true;
 }
 
-size_t unparse_movement(char buf[10], move_t *move, chess_t *chess) {
-	char *piece = unparse_piece(move->piece);
-	int x = move->x;
-	int y = move->y;
-	int tx = move->tx;
-	int ty = move->ty;
-	move->x = -1;
-	move->y = -1;
-	bool kind = false;
-	int matches = find_x_y(chess, move, &kind);
-	char d_rank = BOARD_HEIGHT - y + '0';
-	char d_file = 'a' + x;
-	char t_rank = BOARD_HEIGHT - ty + '0';
-	char t_file = 'a' + tx;
-	if (matches == 1) {
-		d_rank = 0;
-		d_file = 0;
-	} else if (matches == 2) {
-		if (kind) {
-			// xs match -> on same file, provide rank information
-			d_file = 0;
-		} else {
-			// ys match -> on same rank, provide file
-			d_rank = 0;
-		}
+/*
+ * writes the move in SAN, as it would be read back in the position it was
+ * played from, followed by a space. out needs room for SAN_MAX characters
+ * and is not terminated. returns the number of characters written
+ */
+static size_t unparse_movement(char *out, move_t *move, chess_t *chess) {
+	char *at = out;
+	if (move->flags & MOVE_CASTLE) {
+		memcpy(at, "O-O-O", 5);
+		at += (move->tx > move->x) ? 3 : 5;
+	} else {
+		int x = move->x;
+		int y = move->y;
+		move->x = -1;
+		move->y = -1;
+		bool kind = false;
+		int matches = find_x_y(chess, move, &kind);
+		// the search leaves its last match behind, put the real squares back
+		move->x = x;
+		move->y = y;
+		bool d_file = matches > 2 || (matches == 2 && !kind);
+		bool d_rank = matches > 2 || (matches == 2 && kind);
+		// pawns always name the file they take from
+		if (PAWN == move->piece)
+			d_file = move->flags & MOVE_CAPTURE;
+		else
+			*at++ = *unparse_piece(move->piece);
+		if (d_file)
+			*at++ = 'a' + x;
+		if (d_rank)
+			*at++ = '0' + BOARD_HEIGHT - y;
+		if (move->flags & MOVE_CAPTURE)
+			*at++ = 'x';
+		*at++ = 'a' + move->tx;
+		*at++ = '0' + BOARD_HEIGHT - move->ty;
+		if (move->flags & MOVE_PROMOTE)
+			*at++ = *unparse_piece(move->promote);
+	}
+	if (move->flags & MOVE_MATE)
+		*at++ = '#';
+	else if (move->flags & MOVE_CHECK)
+		*at++ = '+';
+	*at++ = ' ';
+	return at - out;
+}
+
+// hands out n bytes from the game's arena, taking another block when the newest is full
+static void *arena_alloc(struct chess_arena *arena, size_t n) {
+	n = (n + sizeof(max_align_t) - 1) / sizeof(max_align_t) * sizeof(max_align_t);
+	arena_block *b = arena->blocks;
+	if (NULL == b || b->size - b->used < n) {
+		size_t size = (n > ARENA_BLOCK) ? n : ARENA_BLOCK;
+		b = malloc(sizeof *b + size);
+		b->size = size;
+		b->used = 0;
+		b->next = arena->blocks;
+		arena->blocks = b;
+	}
+	void *ret = (char *) b->data + b->used;
+	b->used += n;
+	return ret;
+}
+
+// empties the arena and starts the move list over from the current position
+static void arena_restart(chess_t *chess) {
+	struct chess_arena *arena = chess->arena;
+	// keep the oldest block around for the next game
+	while (NULL != arena->blocks->next) {
+		arena_block *next = arena->blocks->next;
+		free(arena->blocks);
+		arena->blocks = next;
 	}
-	char disambig[3];
-	snprintf(disambig, 3, "%c%c", d_file, d_rank);
-	if (0 == *disambig) {
-		disambig[0] = disambig[1];
-		disambig[1] = 0;
+	arena->blocks->used = 0;
+	arena->plies = NULL;
+	arena->n_plies = arena->end_plies = arena->cap_plies = 0;
+	arena->history = NULL;
+	arena->h_cap = arena->h_len = 0;
+	arena->h_plies = 0;
+	arena->checks = NULL;
+	arena->n_checks = arena->cap_checks = 0;
+	// no position hashes to 0, so the cache is empty until it is asked for
+	arena->cache.hash = 0;
+	arena->cache.valid[WHITE] = arena->cache.valid[BLACK] = 0;
+	arena->start = *chess;
+	arena->h_pos = *chess;
+}
+
+// packs the position into cp, a nibble a square, as it stands after ply plies
+static void checkpoint(const chess_t *chess, unsigned int ply, chess_checkpoint *cp) {
+	memset(cp, 0, sizeof *cp);
+	cp->ply = ply;
+	cp->ep = ep_square(chess->b);
+	cp->castle = chess->castle;
+	cp->turn = chess->turn;
+	cp->halfmoves = (chess->halfmoves > UINT8_MAX) ? UINT8_MAX : chess->halfmoves;
+	for (int sq = 0; sq < BOARD_LENGTH * BOARD_HEIGHT; ++sq) {
+		chess_piece p = chess->b[sq / BOARD_LENGTH][sq % BOARD_LENGTH];
+		if (p.pi >= PAWN)
+			cp->squares[sq / 2] |= ((p.pi + 1) | p.c << 3) << (sq % 2 * 4);
 	}
-	char take[2];
-	snprintf(take, 2, "%c", move->flags & MOVE_CAPTURE ? 'x' : '\0');
-	char end[2];
-	snprintf(end, 2, "%c", (move->flags & MOVE_CHECK) ? '+' : ((move->flags & MOVE_MATE) ? '#' : '\0'));
-	// put everything together
-	return snprintf(buf, 10, "%s%s%s%c%c%s ", piece, disambig, take, t_file, t_rank, end);
 }
 
-unsigned int ensure_space(char **arr, unsigned int cur_size, unsigned int req_size) {
-	if (cur_size <= req_size)
-		return cur_size;
-	while ((cur_size *= 2) < req_size);
-	*arr = realloc(*arr, cur_size);
-	return cur_size;
+// keeps a checkpoint of the position the game is in, which ply plies made
+static void add_checkpoint(chess_t *chess, unsigned int ply) {
+	struct chess_arena *arena = chess->arena;
+	if (arena->n_checks == arena->cap_checks) {
+		unsigned int cap = arena->cap_checks ? arena->cap_checks * 2 : ARENA_PLIES / 4;
+		chess_checkpoint *checks = arena_alloc(arena, cap * sizeof *checks);
+		if (arena->n_checks)
+			memcpy(checks, arena->checks, arena->n_checks * sizeof *checks);
+		arena->checks = checks;
+		arena->cap_checks = cap;
+	}
+	checkpoint(chess, ply, &arena->checks[arena->n_checks++]);
 }
 
-void append_history(chess_t *chess, move_t *move) {
-	char buf[10];
-	size_t move_len = unparse_movement(buf, move, chess);
-	chess->h_len = ensure_space(&chess->history, 
-			chess->h_len, 
-			chess->h_end + move_len + (WHITE == chess->turn) ? 8 : 0);
-	if (WHITE == chess->turn) {
-		char num[8];
-		int num_size = snprintf(num, 8, "%u. ", chess->moves / 2 + 1);
-		memcpy(chess->history + chess->h_end - 1, num, num_size + 1);
-		chess->h_end += num_size;
+// adds a ply to the game, dropping any that were taken back
+static void record(chess_t *chess, const ply_t *ply) {
+	struct chess_arena *arena = chess->arena;
+	arena->end_plies = arena->n_plies;
+	if (arena->n_plies == arena->cap_plies) {
+		// the old list stays behind in the arena until the game ends
+		unsigned int cap = arena->cap_plies ? arena->cap_plies * 2 : ARENA_PLIES;
+		ply_t *plies = arena_alloc(arena, cap * sizeof *plies);
+		if (arena->n_plies)
+			memcpy(plies, arena->plies, arena->n_plies * sizeof *plies);
+		arena->plies = plies;
+		arena->cap_plies = cap;
+	}
+	arena->plies[arena->n_plies++] = *ply;
+	arena->end_plies = arena->n_plies;
+	if (arena->k_checks) {
+		// those from the ply just played on were for moves taken back
+		if (arena->n_checks > (arena->n_plies - 1) / arena->k_checks)
+			arena->n_checks = (arena->n_plies - 1) / arena->k_checks;
+		if (0 == arena->n_plies % arena->k_checks)
+			add_checkpoint(chess, arena->n_plies);
 	}
-	memcpy(chess->history + chess->h_end - 1, buf, move_len + 1);
-	chess->h_end += move_len;
 }
 
 // returns -1 if error,
@@ -851,8 +1287,7 @@ void append_history(chess_t *chess, move_t *move) {
 // 2 if checkmate
 chess_return move(chess_t *chess_board, char *notation) {
 	move_t move;
-	char *promote = NULL;
-	if (!parse_movement(notation, chess_board->turn, &move, promote)) {
+	if (!parse_movement(notation, chess_board->turn, &move)) {
 		//fprintf(stderr, "notation syntax error: %s\n", notation);
 		return CHESS_ERR_PARSE;
 	}
@@ -865,72 +1300,1640 @@ chess_return move(chess_t *chess_board, char *notation) {
 		//fprintf(stderr, "no piece can achieve %s\n", notation);
 		return CHESS_ERR_NOAVAIL;
 	}
+	return play(chess_board, &move);
+}
+
+/*
+ * forgets the cached targets the last move may have changed. hash, before,
+ * ep and check are what the position had before it: pieces whose deps it
+ * touched go, kings always do, and so does all of a side that is or was in
+ * check, since any of its moves may have stopped or started answering it
+ */
+static void cache_moved(chess_t *chess, uint64_t hash, const uint64_t before[2][CHESS_NUM_PIECES], int ep, color check) {
+	struct move_cache *mc = &chess->arena->cache;
+	if (mc->hash != hash)
+		return;
+	mc->hash = chess->hash;
+	uint64_t changed = 0;
+	for (int p = 0; p < CHESS_NUM_PIECES; ++p)
+		changed |= (before[WHITE][p] ^ chess->pieces[WHITE][p]) | (before[BLACK][p] ^ chess->pieces[BLACK][p]);
+	int now = ep_square(chess->b);
+	if (ep >= 0)
+		changed |= 1ULL << ep;
+	if (now >= 0)
+		changed |= 1ULL << now;
+	for (int c = WHITE; c <= BLACK; ++c) {
+		if (check == c || chess->check == c) {
+			mc->valid[c] = 0;
+			continue;
+		}
+		uint64_t keep = mc->valid[c] & ~chess->pieces[c][KING];
+		for (uint64_t left = keep; left; left &= left - 1)
+			if (mc->deps[c][__builtin_ctzll(left)] & changed)
+				keep &= ~(left & -left);
+		mc->valid[c] = keep;
+	}
+}
+
+// puts a move test_move has passed onto the game, tmp_b being the board it left behind
+static void commit(chess_t *chess_board, const move_t *move, board tmp_b, int kcopy[2], castle_state cstate, color check) {
+	color turn = swith(chess_board->turn);
+	// the cache only needs to know what changed if it holds anything for this position
+	uint64_t hash = chess_board->hash, before[2][CHESS_NUM_PIECES];
+	color was = chess_board->check;
+	bool cached = chess_board->arena->cache.hash == hash;
+	int ep = cached ? ep_square(chess_board->b) : -1;
+	if (cached)
+		memcpy(before, chess_board->pieces, sizeof before);
+	chess_board->moves++;
+	if (PAWN == move->piece || chess_board->b[move->ty][move->tx].pi >= PAWN)
+		chess_board->halfmoves = 0;
+	else
+		chess_board->halfmoves++;
+	int old_ep = ep_file(chess_board->b);
+	memcpy(*chess_board->b, *tmp_b, sizeof chess_board->b);
+	// only the squares this move touched can have changed hands
+	sync_square(chess_board, move->x, move->y);
+	sync_square(chess_board, move->tx, move->ty);
+	sync_square(chess_board, move->tx, move->y);	// a pawn taken en passant
+	if (move->flags & MOVE_CASTLE) {
+		sync_square(chess_board, 0, move->y);
+		sync_square(chess_board, 3, move->y);
+		sync_square(chess_board, BOARD_LENGTH - 1, move->y);
+		sync_square(chess_board, BOARD_LENGTH - 3, move->y);
+	}
+	chess_board->kpos[chess_board->turn][0] = kcopy[0];
+	chess_board->kpos[chess_board->turn][1] = kcopy[1];
+	int new_ep = ep_file(chess_board->b);
+	if (old_ep >= 0)
+		chess_board->hash ^= zobrist_ep[old_ep];
+	if (new_ep >= 0)
+		chess_board->hash ^= zobrist_ep[new_ep];
+	chess_board->hash ^= castle_hash(chess_board->castle & cstate);
+	chess_board->hash ^= zobrist_turn[0];
+	chess_board->castle &= ~cstate;
+	chess_board->turn = turn;
+	chess_board->check = check;
+	if (cached)
+		cache_moved(chess_board, hash, before, ep, was);
+}
+
+// plays a move again that was legal when it was recorded, so only the board needs working out
+static void replay(chess_t *chess, move_t *move) {
+	board tmp_b;
+	int kcopy[2];
+	castle_state cstate;
+	test_move(chess, move, tmp_b, kcopy, &cstate);
+	commit(chess, move, tmp_b, kcopy, cstate,
+			(move->flags & (MOVE_CHECK | MOVE_MATE)) ? swith(chess->turn) : NOCOLOR);
+}
+
+/*
+ * makes a move whose piece and squares are already known, after checking
+ * it is legal and that any check or mate it claims comes true
+ */
+static chess_return play(chess_t *chess_board, move_t *move) {
 	board tmp_b;
 	castle_state cstate;
 	int kcopy[2];
-	if (!test_move(chess_board, &move, tmp_b, kcopy, promote, &cstate)) {
+	if (!test_move(chess_board, move, tmp_b, kcopy, &cstate)) {
 		//fprintf(stderr, "unable to make %s\n", notation);
 		return CHESS_ERR_ILLEGAL;
 	}
 	color turn  = swith(chess_board->turn);
-	color check = incheck(tmp_b, chess_board->kpos[turn][0], chess_board->kpos[turn][1])
-		? turn
-		: NOCOLOR;
+	uint64_t after[2][CHESS_NUM_PIECES];
+	sets_after(chess_board, move, tmp_b, after);
+	color check = incheck(after, turn) ? turn : NOCOLOR;
 	char ret = CHESS_NORMAL;
 	if (legal_move_exists(tmp_b, turn, chess_board->kpos[turn][0], chess_board->kpos[turn][1], check != NOCOLOR)) {
 		// if the user says this move results in mate, return error
-		if (move.flags & MOVE_MATE)
+		if (move->flags & MOVE_MATE)
 			return CHESS_ERR_PROMISE;
 		// if the user says this move results in check and it does not, return error
-		if (NOCOLOR == check && move.flags & MOVE_CHECK)
+		if (NOCOLOR == check && move->flags & MOVE_CHECK)
 			return CHESS_ERR_PROMISE;
 		if (NOCOLOR != check) {
 			ret = CHESS_CHECK;
-			move.flags |= MOVE_CHECK;
+			move->flags |= MOVE_CHECK;
 		}
 	} else {
 		// no legal move exists
-		if (NOCOLOR == check && move.flags & MOVE_MATE)
+		if (NOCOLOR == check && move->flags & MOVE_MATE)
 			return CHESS_ERR_PROMISE;
 		ret = (NOCOLOR == check) ? CHESS_STALE : CHESS_MATE;
 		if (CHESS_MATE == ret)
-			move.flags |= MOVE_MATE;
+			move->flags |= MOVE_MATE;
 	}
 
-	// TODO record this move
-	chess_board->moves++;
-	append_history(chess_board, &move);
-
-	memcpy(*chess_board->b, *tmp_b, sizeof chess_board->b);
-	chess_board->kpos[chess_board->turn][0] = kcopy[0];
-	chess_board->kpos[chess_board->turn][1] = kcopy[1];
-	chess_board->castle &= ~cstate;
-	chess_board->turn = turn;
-	chess_board->check = check;
+	ply_t ply = {
+		.move = *move,
+		.result = ret,
+		.taken = chess_board->b[move->ty][move->tx],
+		.ep = ep_square(chess_board->b),
+		.kpos = { chess_board->kpos[chess_board->turn][0], chess_board->kpos[chess_board->turn][1] },
+		.castle = chess_board->castle,
+		.check = chess_board->check,
+		.halfmoves = chess_board->halfmoves,
+		.hash = chess_board->hash
+	};
+	commit(chess_board, move, tmp_b, kcopy, cstate, check);
+	record(chess_board, &ply);
 
 	return ret;
 }
 
-void reset(chess_t *chess_board) {
-	board tmp = BOARD_START(WHITE);
-	memcpy(*(chess_board->b), *tmp, sizeof chess_board->b);
-	chess_board->turn = WHITE;
-	chess_board->check = NOCOLOR;
-	chess_board->castle = B_CASTLE_KING | B_CASTLE_QUEEN | W_CASTLE_KING | W_CASTLE_QUEEN;
-	chess_board->kpos[0][0] = 4;
-	chess_board->kpos[0][1] = 7;
-	chess_board->kpos[1][0] = 4;
-	chess_board->kpos[1][1] = 0;
-	chess_board->moves = 0;
-	chess_board->h_len = 16;
-	chess_board->h_end = 1;
-	chess_board->history = malloc(chess_board->h_len * sizeof *(chess_board->history));
-	memset(chess_board->history, 0, chess_board->h_len * sizeof *(chess_board->history));
+// works the piece sets and hash out from scratch for the whole position
+static void rebuild_sets(chess_t *chess) {
+	memset(chess->pieces, 0, sizeof chess->pieces);
+	chess->hash = 0;
+	for (int y = 0; y < BOARD_HEIGHT; ++y)
+		for (int x = 0; x < BOARD_LENGTH; ++x)
+			sync_square(chess, x, y);
+	chess->hash ^= castle_hash(chess->castle);
+	int ep = ep_file(chess->b);
+	if (ep >= 0)
+		chess->hash ^= zobrist_ep[ep];
+	if (BLACK == chess->turn)
+		chess->hash ^= zobrist_turn[0];
 }
 
-void cleanup (chess_t *chess_board)
-{
-	free (chess_board->history);
+static chess_p fen_piece(char c) {
+	static const char letters[] = "PRNBQK";
+	char *at = strchr(letters, toupper(c));
+	return (NULL == at || '\0' == c) ? BLANK : (chess_p) (at - letters);
+}
+
+/*
+ * writes the position out as FEN into buf, which needs room for
+ * CHESS_FEN_MAX characters, and returns its length
+ */
+size_t chess_fen(const chess_t *chess, char *buf) {
+	static const char letters[] = "PRNBQK";
+	char *at = buf;
+	for (int y = 0; y < BOARD_HEIGHT; ++y) {
+		int blanks = 0;
+		for (int x = 0; x < BOARD_LENGTH; ++x) {
+			chess_piece p = chess->b[y][x];
+			if (!occupied(chess->b, x, y)) {
+				blanks++;
+				continue;
+			}
+			if (blanks)
+				*at++ = '0' + blanks;
+			blanks = 0;
+			*at++ = (WHITE == p.c) ? letters[p.pi] : tolower(letters[p.pi]);
+		}
+		if (blanks)
+			*at++ = '0' + blanks;
+		*at++ = (y < BOARD_HEIGHT - 1) ? '/' : ' ';
+	}
+	*at++ = (WHITE == chess->turn) ? 'w' : 'b';
+	*at++ = ' ';
+	static const struct { castle_state right; char letter; } rights[] = {
+		{ W_CASTLE_KING, 'K' }, { W_CASTLE_QUEEN, 'Q' }, { B_CASTLE_KING, 'k' }, { B_CASTLE_QUEEN, 'q' }
+	};
+	char *castles = at;
+	for (int i = 0; i < 4; ++i)
+		if (chess->castle & rights[i].right)
+			*at++ = rights[i].letter;
+	if (at == castles)
+		*at++ = '-';
+	*at++ = ' ';
+	int ep = ep_square(chess->b);
+	if (ep >= 0) {
+		*at++ = 'a' + ep % BOARD_LENGTH;
+		*at++ = '0' + BOARD_HEIGHT - ep / BOARD_LENGTH;
+	} else {
+		*at++ = '-';
+	}
+	at += sprintf(at, " %u %u", chess->halfmoves, chess->moves / 2 + 1);
+	return at - buf;
+}
+
+// the same for the position the game started from
+size_t chess_start_fen(const chess_t *chess, char *buf) {
+	return chess_fen(&chess->arena->start, buf);
+}
+
+/*
+ * sets up the position described by a FEN string, leaving the history empty.
+ * returns 0 on success, or -1 without touching the game if the FEN is bad
+ */
+int chess_load_fen(chess_t *chess, const char *fen) {
+	board b;
+	int kings[2] = { 0, 0 };
+	int kpos[2][2] = { { -1, -1 }, { -1, -1 } };
+	int x = 0, y = 0;
+	for (; *fen && ' ' != *fen; ++fen) {
+		if ('/' == *fen) {
+			if (x != BOARD_LENGTH || ++y >= BOARD_HEIGHT)
+				return -1;
+			x = 0;
+			continue;
+		}
+		if (isdigit(*fen)) {
+			for (int n = *fen - '0'; n > 0; --n, ++x) {
+				if (x >= BOARD_LENGTH)
+					return -1;
+				b[y][x] = (chess_piece) { .pi = BLANK, .c = WHITE };
+			}
+			continue;
+		}
+		chess_p p = fen_piece(*fen);
+		if (BLANK == p || x >= BOARD_LENGTH)
+			return -1;
+		color c = isupper(*fen) ? WHITE : BLACK;
+		b[y][x] = (chess_piece) { .pi = p, .c = c };
+		if (KING == p) {
+			kings[c]++;
+			kpos[c][0] = x;
+			kpos[c][1] = y;
+		}
+		x++;
+	}
+	if (x != BOARD_LENGTH || y != BOARD_HEIGHT - 1 || kings[WHITE] != 1 || kings[BLACK] != 1)
+		return -1;
+
+	char side = 'w', castling[5] = "-", ep[3] = "-";
+	unsigned int halfmove = 0, fullmove = 1;
+	if (sscanf(fen, " %c %4s %2s %u %u", &side, castling, ep, &halfmove, &fullmove) < 1 ||
+			('w' != side && 'b' != side))
+		return -1;
+	color turn = ('w' == side) ? WHITE : BLACK;
+	castle_state castle = 0;
+	for (char *c = castling; *c && '-' != *c; ++c) {
+		switch (*c) {
+			case 'K':
+				castle |= W_CASTLE_KING;
+				break;
+			case 'Q':
+				castle |= W_CASTLE_QUEEN;
+				break;
+			case 'k':
+				castle |= B_CASTLE_KING;
+				break;
+			case 'q':
+				castle |= B_CASTLE_QUEEN;
+				break;
+			default:
+				return -1;
+		}
+	}
+	if ('-' != *ep) {
+		int ex = ep[0] - 'a';
+		int ey = BOARD_HEIGHT - (ep[1] - '0');
+		// only behind a pawn of the other side that could have just jumped
+		if (!ep_allowed(b, turn, ex, ey))
+			return -1;
+		// the pawn that just jumped past this square belongs to the other side
+		b[ey][ex] = (chess_piece) { .pi = F_PAWN, .c = swith(turn) };
+	}
+	// the side that just moved can't have left its king in check
+	if (attacked(b, turn, kpos[swith(turn)][0], kpos[swith(turn)][1], -1, -1))
+		return -1;
+
+	memcpy(*chess->b, *b, sizeof chess->b);
+	memcpy(chess->kpos, kpos, sizeof chess->kpos);
+	chess->turn = turn;
+	chess->castle = castle;
+	chess->check = attacked(b, swith(turn), kpos[turn][0], kpos[turn][1], -1, -1) ? turn : NOCOLOR;
+	chess->moves = (fullmove > 0 ? fullmove - 1 : 0) * 2 + turn;
+	chess->halfmoves = halfmove;
+	rebuild_sets(chess);
+	arena_restart(chess);
+	return 0;
+}
+
+// fills in a move_t for the piece standing on (x, y), flagging castles and promotions
+static void describe_move(const chess_t *chess, move_t *move, int x, int y, int tx, int ty, chess_p promote) {
+	move->x = x;
+	move->y = y;
+	move->tx = tx;
+	move->ty = ty;
+	move->piece = chess->b[y][x].pi;
+	move->promote = promote;
+	move->flags = 0;
+	if (KING == move->piece && abs(tx - x) == 2)
+		move->flags |= MOVE_CASTLE;
+	if (BLANK != promote)
+		move->flags |= MOVE_PROMOTE;
+}
+
+/*
+ * makes the move from (x, y) to (tx, ty) without any notation to parse or
+ * piece to search for. promote is the piece a pawn becomes on the far rank,
+ * BLANK otherwise, and a castle is the king moving two squares.
+ */
+chess_return chess_move_coord(chess_t *chess, int x, int y, int tx, int ty, chess_p promote) {
+	if (out_of_bounds(x, y) || out_of_bounds(tx, ty))
+		return CHESS_ERR_PARSE;
+	chess_piece p = chess->b[y][x];
+	if (p.pi < PAWN || p.c != chess->turn)
+		return CHESS_ERR_NOAVAIL;
+	move_t move;
+	describe_move(chess, &move, x, y, tx, ty, promote);
+	if (!(move.flags & MOVE_CASTLE) && !can_move(chess->b, x, y, tx, ty))
+		return CHESS_ERR_ILLEGAL;
+	if ((move.flags & MOVE_CASTLE) && (ty != y || x != 4 || y != (BOARD_HEIGHT - 1) * swith(chess->turn)))
+		return CHESS_ERR_ILLEGAL;
+	return play(chess, &move);
+}
+
+static chess_p lan_promotion(char c) {
+	switch (c) {
+		case 'q':
+			return QUEEN;
+		case 'r':
+			return ROOK;
+		case 'b':
+			return BISHOP;
+		case 'n':
+			return KNIGHT;
+		default:
+			return PAWN;
+	}
+}
+
+/*
+ * makes a move written in long algebraic form, the from and to squares
+ * and an optional promotion letter, as in e2e4 or e7e8q
+ */
+chess_return chess_move_lan(chess_t *chess, const char *lan) {
+	size_t len = strlen(lan);
+	if (len < 4 || len > 5)
+		return CHESS_ERR_PARSE;
+	chess_p promote = (5 == len) ? lan_promotion(lan[4]) : BLANK;
+	if (PAWN == promote)
+		return CHESS_ERR_PARSE;
+	return chess_move_coord(chess, lan[0] - 'a', BOARD_HEIGHT - (lan[1] - '0'),
+			lan[2] - 'a', BOARD_HEIGHT - (lan[3] - '0'), promote);
+}
+
+/*
+ * takes the last move back. returns what the move before it returned, or
+ * the check state at the start, and CHESS_ERR_NOAVAIL if no move was made
+ */
+chess_return chess_undo(chess_t *chess) {
+	struct chess_arena *arena = chess->arena;
+	if (0 == arena->n_plies)
+		return CHESS_ERR_NOAVAIL;
+	const ply_t *ply = &arena->plies[--arena->n_plies];
+	const move_t *m = &ply->move;
+	color mover = swith(chess->turn);
+	uint64_t hash = chess->hash, before[2][CHESS_NUM_PIECES];
+	memcpy(before, chess->pieces, sizeof before);
+	int ep = ep_square(chess->b);
+	color was = chess->check;
+	chess->b[m->y][m->x] = (chess_piece) { .pi = m->piece, .c = mover };
+	chess->b[m->ty][m->tx] = ply->taken;
+	if (PAWN == m->piece && abs(m->ty - m->y) == 2)
+		chess->b[(m->y + m->ty) / 2][m->x] = (chess_piece) { .pi = BLANK, .c = WHITE };
+	if (PAWN == m->piece && F_PAWN == ply->taken.pi)
+		chess->b[m->y][m->tx] = (chess_piece) { .pi = PAWN, .c = chess->turn };
+	if (m->flags & MOVE_CASTLE) {
+		int rx = (m->tx > m->x) ? BOARD_LENGTH - 1 : 0;
+		chess->b[m->y][rx] = (chess_piece) { .pi = ROOK, .c = mover };
+		chess->b[m->y][(m->x + m->tx) / 2] = (chess_piece) { .pi = BLANK, .c = WHITE };
+	}
+	if (ply->ep >= 0)
+		chess->b[ply->ep / BOARD_LENGTH][ply->ep % BOARD_LENGTH] = (chess_piece) { .pi = F_PAWN, .c = chess->turn };
+	sync_square(chess, m->x, m->y);
+	sync_square(chess, m->tx, m->ty);
+	sync_square(chess, m->tx, m->y);
+	if (m->flags & MOVE_CASTLE) {
+		sync_square(chess, 0, m->y);
+		sync_square(chess, 3, m->y);
+		sync_square(chess, BOARD_LENGTH - 1, m->y);
+		sync_square(chess, BOARD_LENGTH - 3, m->y);
+	}
+	chess->kpos[mover][0] = ply->kpos[0];
+	chess->kpos[mover][1] = ply->kpos[1];
+	chess->castle = ply->castle;
+	chess->check = ply->check;
+	chess->hash = ply->hash;
+	chess->halfmoves = ply->halfmoves;
+	chess->turn = mover;
+	chess->moves--;
+	cache_moved(chess, hash, before, ep, was);
+	// the history written so far went past this point, start it over
+	if (arena->h_plies > arena->n_plies) {
+		arena->h_plies = 0;
+		arena->h_len = 0;
+		arena->h_pos = arena->start;
+	}
+	if (arena->n_plies)
+		return arena->plies[arena->n_plies - 1].result;
+	return (NOCOLOR != chess->check) ? CHESS_CHECK : CHESS_NORMAL;
+}
+
+/*
+ * plays the last move taken back again. returns what the move returned
+ * when it was first played, or CHESS_ERR_NOAVAIL if there is none
+ */
+chess_return chess_redo(chess_t *chess) {
+	struct chess_arena *arena = chess->arena;
+	if (arena->n_plies == arena->end_plies)
+		return CHESS_ERR_NOAVAIL;
+	ply_t *ply = &arena->plies[arena->n_plies++];
+	move_t move = ply->move;
+	replay(chess, &move);
+	return ply->result;
+}
+
+// fills m with the last move played, returns 0, or -1 if there is none
+int chess_last_move(const chess_t *chess, chess_move *m) {
+	const struct chess_arena *arena = chess->arena;
+	if (0 == arena->n_plies)
+		return -1;
+	const move_t *last = &arena->plies[arena->n_plies - 1].move;
+	*m = (chess_move) { .x = last->x, .y = last->y, .tx = last->tx, .ty = last->ty,
+		.promote = (last->flags & MOVE_PROMOTE) ? last->promote : BLANK };
+	return 0;
+}
+
+// the halfmove clock after ply plies of the game
+static unsigned int halfmoves_at(const struct chess_arena *arena, unsigned int ply) {
+	if (ply < arena->end_plies)
+		return arena->plies[ply].halfmoves;
+	if (0 == ply)
+		return arena->start.halfmoves;
+	const ply_t *last = &arena->plies[ply - 1];
+	return (PAWN == last->move.piece || last->taken.pi >= PAWN) ? 0 : last->halfmoves + 1;
+}
+
+/*
+ * sets the position from a checkpoint, starting the game over from there.
+ * moves is what chess_t.moves reads in it. returns -1, leaving chess as it
+ * was, if cp doesn't hold one king of each color, puts the en passant
+ * square where no pawn just jumped, or leaves a king to be taken
+ */
+static int restore(chess_t *chess, const chess_checkpoint *cp, unsigned int moves) {
+	board b;
+	int kings[2] = { 0 }, kpos[2][2] = { { 0 } };
+	for (int sq = 0; sq < BOARD_LENGTH * BOARD_HEIGHT; ++sq) {
+		int x = sq % BOARD_LENGTH, y = sq / BOARD_LENGTH;
+		int nibble = cp->squares[sq / 2] >> (sq % 2 * 4) & 0xf;
+		if (0 == (nibble & 7) || (nibble & 7) > CHESS_NUM_PIECES) {
+			b[y][x] = (chess_piece) { .pi = BLANK, .c = WHITE };
+			continue;
+		}
+		b[y][x] = (chess_piece) { .pi = (nibble & 7) - 1, .c = nibble >> 3 };
+		if (KING == b[y][x].pi) {
+			kings[nibble >> 3]++;
+			kpos[nibble >> 3][0] = x;
+			kpos[nibble >> 3][1] = y;
+		}
+	}
+	if (1 != kings[WHITE] || 1 != kings[BLACK])
+		return -1;
+	color turn = cp->turn ? BLACK : WHITE;
+	if (cp->ep >= 0) {
+		int ex = cp->ep % BOARD_LENGTH, ey = cp->ep / BOARD_LENGTH;
+		if (!ep_allowed(b, turn, ex, ey))
+			return -1;
+		b[ey][ex] = (chess_piece) { .pi = F_PAWN, .c = swith(turn) };
+	} else if (-1 != cp->ep) {
+		return -1;
+	}
+	// the side that just moved can't have left its king in check
+	if (attacked(b, turn, kpos[swith(turn)][0], kpos[swith(turn)][1], -1, -1))
+		return -1;
+
+	memcpy(*chess->b, *b, sizeof chess->b);
+	memcpy(chess->kpos, kpos, sizeof chess->kpos);
+	chess->turn = turn;
+	chess->castle = cp->castle & (B_CASTLE_KING | B_CASTLE_QUEEN | W_CASTLE_KING | W_CASTLE_QUEEN);
+	chess->check = attacked(b, swith(turn), kpos[turn][0], kpos[turn][1], -1, -1) ? turn : NOCOLOR;
+	chess->moves = moves;
+	chess->halfmoves = cp->halfmoves;
+	rebuild_sets(chess);
+	return 0;
+}
+
+/*
+ * sets how many plies apart the game keeps checkpoints, 0 for none, and
+ * works them out again for the moves played so far
+ */
+void chess_set_checkpoints(chess_t *chess, unsigned int k) {
+	struct chess_arena *arena = chess->arena;
+	arena->k_checks = k;
+	arena->n_checks = 0;
+	if (0 == k)
+		return;
+	chess_t at = arena->start;
+	for (unsigned int i = 0; i < arena->end_plies; ++i) {
+		move_t move = arena->plies[i].move;
+		replay(&at, &move);
+		if (0 == (i + 1) % k)
+			add_checkpoint(&at, i + 1);
+	}
+}
+
+// points checks at the game's checkpoints, to be stored with its history, and returns how many
+size_t chess_checkpoints(const chess_t *chess, const chess_checkpoint **checks) {
+	*checks = chess->arena->checks;
+	return chess->arena->n_checks;
+}
+
+/*
+ * goes to the position ply plies into the game, forwards or backwards,
+ * without checking any of the moves again. it starts from the nearest
+ * checkpoint at or before ply, so plays no more than the checkpoint
+ * interval worth of moves. the moves after ply can still be redone.
+ * returns what the last move returned when it was first played, or
+ * CHESS_ERR_NOAVAIL if the game never got that far
+ */
+chess_return chess_seek(chess_t *chess, unsigned int ply) {
+	struct chess_arena *arena = chess->arena;
+	if (ply > arena->end_plies)
+		return CHESS_ERR_NOAVAIL;
+	// only go back to a checkpoint if it is closer than where the game is
+	unsigned int from = arena->n_plies;
+	if (ply < from || (arena->k_checks && ply / arena->k_checks > from / arena->k_checks)) {
+		unsigned int i = arena->k_checks ? ply / arena->k_checks : 0;
+		if (i > arena->n_checks)
+			i = arena->n_checks;
+		if (i > 0) {
+			restore(chess, &arena->checks[i - 1], arena->start.moves + arena->checks[i - 1].ply);
+			from = arena->checks[i - 1].ply;
+			// the checkpoint holds the clock only up to 255, the plies have all of it
+			chess->halfmoves = halfmoves_at(arena, from);
+		} else {
+			*chess = arena->start;
+			from = 0;
+		}
+	}
+	for (arena->n_plies = from; arena->n_plies < ply; ++arena->n_plies) {
+		move_t move = arena->plies[arena->n_plies].move;
+		replay(chess, &move);
+	}
+	// the history written so far went past this point, start it over
+	if (arena->h_plies > arena->n_plies) {
+		arena->h_plies = 0;
+		arena->h_len = 0;
+		arena->h_pos = arena->start;
+	}
+	if (arena->n_plies)
+		return arena->plies[arena->n_plies - 1].result;
+	return (NOCOLOR != chess->check) ? CHESS_CHECK : CHESS_NORMAL;
+}
+
+/*
+ * goes to the position ply plies into a game stored as its history, as
+ * chess_history() wrote it, and the checkpoints chess_checkpoints() gave
+ * for it. chess is set at the position the game started from. only the
+ * moves from the nearest checkpoint on are played, and the game carries
+ * on from there, so moves before that can't be taken back. returns what
+ * the last move played returned, CHESS_ERR_NOAVAIL if the history is
+ * shorter than ply, or the error from a move that couldn't be played
+ */
+chess_return chess_seek_history(chess_t *chess, const char *history, const chess_checkpoint *checks, size_t n, unsigned int ply) {
+	unsigned int from = 0;
+	const chess_checkpoint *best = NULL;
+	for (size_t i = 0; i < n; ++i)
+		if (checks[i].ply <= ply && (NULL == best || checks[i].ply > best->ply))
+			best = &checks[i];
+	if (NULL != best) {
+		if (restore(chess, best, chess->moves + best->ply) < 0)
+			return CHESS_ERR;
+		arena_restart(chess);
+		from = best->ply;
+	}
+	chess_return ret = (NOCOLOR != chess->check) ? CHESS_CHECK : CHESS_NORMAL;
+	for (unsigned int i = 0; i < ply; ) {
+		while (' ' == *history)
+			history++;
+		size_t len = strcspn(history, " ");
+		if (0 == len)
+			return CHESS_ERR_NOAVAIL;
+		const char *san = history;
+		history += len;
+		// move numbers, "12." or "12..."
+		if ('.' == san[len - 1])
+			continue;
+		if (i++ < from)
+			continue;
+		char buf[SAN_MAX + 1];
+		if (len > SAN_MAX)
+			return CHESS_ERR_PARSE;
+		memcpy(buf, san, len);
+		buf[len] = '\0';
+		if ((ret = move(chess, buf)) < 0)
+			return ret;
+	}
+	return ret;
+}
+
+// a position as chess_serialize() writes it
+typedef struct {
+	chess_checkpoint pos;
+	uint32_t moves;
+	int8_t kpos[2][2];
+	int8_t check;
+	uint8_t unused;
+	// the halfmove clock, held at UINT16_MAX past that
+	uint16_t halfmoves;
+} saved_pos;
+
+// a ply as chess_serialize() writes it, see ply_t
+typedef struct {
+	uint64_t hash;
+	int8_t x, y, tx, ty;
+	int8_t piece, promote, flags, result;
+	int8_t taken, taken_c, ep, check;
+	int8_t kpos[2];
+	uint8_t castle, unused;
+} saved_ply;
+
+typedef struct {
+	char magic[GAME_MAGIC_LEN];
+	uint32_t size, n_plies, end_plies, n_checks, k_checks, unused;
+	saved_pos start, now;
+} saved_game;
+
+static void save_pos(const chess_t *chess, saved_pos *sp) {
+	memset(sp, 0, sizeof *sp);
+	checkpoint(chess, 0, &sp->pos);
+	sp->moves = chess->moves;
+	for (int c = 0; c < 2; ++c) {
+		sp->kpos[c][0] = chess->kpos[c][0];
+		sp->kpos[c][1] = chess->kpos[c][1];
+	}
+	sp->check = chess->check;
+	sp->halfmoves = (chess->halfmoves > UINT16_MAX) ? UINT16_MAX : chess->halfmoves;
+}
+
+/*
+ * writes the whole game, the position it started from and where it is
+ * now, every move played or taken back and its checkpoints, into buf in
+ * a fixed layout, in the byte order of the machine. nothing is written
+ * unless all of it fits in cap bytes. returns the size it takes
+ */
+size_t chess_serialize(const chess_t *chess, void *buf, size_t cap) {
+	const struct chess_arena *arena = chess->arena;
+	size_t size = sizeof(saved_game) + arena->end_plies * sizeof(saved_ply) + arena->n_checks * sizeof(chess_checkpoint);
+	if (size > cap)
+		return size;
+	saved_game *g = buf;
+	memset(g, 0, sizeof *g);
+	memcpy(g->magic, GAME_MAGIC, GAME_MAGIC_LEN);
+	g->size = size;
+	g->n_plies = arena->n_plies;
+	g->end_plies = arena->end_plies;
+	g->n_checks = arena->n_checks;
+	g->k_checks = arena->k_checks;
+	save_pos(&arena->start, &g->start);
+	save_pos(chess, &g->now);
+	saved_ply *sp = (saved_ply *) (g + 1);
+	for (unsigned int i = 0; i < arena->end_plies; ++i) {
+		const ply_t *p = &arena->plies[i];
+		sp[i] = (saved_ply) {
+			.hash = p->hash,
+			.x = p->move.x, .y = p->move.y, .tx = p->move.tx, .ty = p->move.ty,
+			.piece = p->move.piece, .promote = p->move.promote, .flags = p->move.flags,
+			.result = p->result, .taken = p->taken.pi, .taken_c = p->taken.c,
+			.ep = p->ep, .check = p->check, .kpos = { p->kpos[0], p->kpos[1] },
+			.castle = p->castle
+		};
+	}
+	if (arena->n_checks)
+		memcpy(sp + arena->end_plies, arena->checks, arena->n_checks * sizeof *arena->checks);
+	return size;
+}
+
+// true if every field of a saved ply holds something a played move can
+static bool saved_ply_ok(const saved_ply *sp) {
+	if (out_of_bounds(sp->x, sp->y) || out_of_bounds(sp->tx, sp->ty) || out_of_bounds(sp->kpos[0], sp->kpos[1]))
+		return false;
+	if (sp->piece < PAWN || sp->piece > KING || sp->taken < F_PAWN || sp->taken > KING)
+		return false;
+	if (sp->taken_c != WHITE && sp->taken_c != BLACK)
+		return false;
+	if (sp->flags & ~(MOVE_CHECK | MOVE_MATE | MOVE_PROMOTE | MOVE_CASTLE | MOVE_CAPTURE))
+		return false;
+	// only a pawn promotes, and only to a rook, knight, bishop or queen
+	if ((sp->flags & MOVE_PROMOTE) ? PAWN != sp->piece || sp->promote < ROOK || sp->promote > QUEEN : BLANK != sp->promote)
+		return false;
+	if (sp->result < CHESS_NORMAL || sp->result > CHESS_STALE || sp->check < NOCOLOR || sp->check > BLACK)
+		return false;
+	return sp->ep >= -1 && sp->ep < BOARD_LENGTH * BOARD_HEIGHT
+		&& 0 == (sp->castle & ~(B_CASTLE_KING | B_CASTLE_QUEEN | W_CASTLE_KING | W_CASTLE_QUEEN));
+}
+
+/*
+ * true if the saved plies play out from start as they were saved: each
+ * move is legal where it stands, each ply holds the position before it as
+ * playing them gives it, and so does every checkpoint and now, the
+ * position n_plies in. only the board's checkpoints are compared, so the
+ * plies must have passed saved_ply_ok() first
+ */
+static bool saved_plies_play(const chess_t *start, const chess_t *now, const saved_game *g) {
+	// moves played here mustn't touch the game's own cache
+	static const struct chess_arena empty;
+	struct chess_arena scratch = empty;
+	chess_t at = *start;
+	at.arena = &scratch;
+	const saved_ply *sp = (const saved_ply *) (g + 1);
+	const chess_checkpoint *checks = (const chess_checkpoint *) (sp + g->end_plies);
+	if (g->n_checks != (g->k_checks ? g->end_plies / g->k_checks : 0))
+		return false;
+	for (unsigned int i = 0; i <= g->end_plies; ++i) {
+		if (i == g->n_plies && (at.hash != now->hash || at.moves != now->moves || at.check != now->check
+				|| (at.halfmoves > UINT16_MAX ? UINT16_MAX : at.halfmoves) != now->halfmoves))
+			return false;
+		if (i == g->end_plies)
+			break;
+		const saved_ply *p = &sp[i];
+		chess_piece from = at.b[p->y][p->x], to = at.b[p->ty][p->tx];
+		if (from.pi != p->piece || from.c != at.turn || to.pi != p->taken || to.c != p->taken_c
+				|| p->ep != ep_square(at.b) || p->check != at.check || p->castle != at.castle || p->hash != at.hash
+				|| p->kpos[0] != at.kpos[at.turn][0] || p->kpos[1] != at.kpos[at.turn][1])
+			return false;
+		// the same checks chess_move_coord() makes, and the flags test_move() would leave
+		move_t move;
+		describe_move(&at, &move, p->x, p->y, p->tx, p->ty, p->promote);
+		if (move.flags != (p->flags & (MOVE_CASTLE | MOVE_PROMOTE)))
+			return false;
+		if (!(move.flags & MOVE_CASTLE) && !can_move(at.b, p->x, p->y, p->tx, p->ty))
+			return false;
+		if ((move.flags & MOVE_CASTLE) && (p->ty != p->y || p->x != 4 || p->y != (BOARD_HEIGHT - 1) * swith(at.turn)))
+			return false;
+		move.flags = (move_flags) p->flags;
+		board tmp_b;
+		int kcopy[2];
+		castle_state cstate;
+		if (!test_move(&at, &move, tmp_b, kcopy, &cstate) || move.flags != (move_flags) p->flags)
+			return false;
+		color turn = swith(at.turn);
+		commit(&at, &move, tmp_b, kcopy, cstate, (move.flags & (MOVE_CHECK | MOVE_MATE)) ? turn : NOCOLOR);
+		if (attacked(at.b, swith(turn), at.kpos[turn][0], at.kpos[turn][1], -1, -1) != (NOCOLOR != at.check))
+			return false;
+		if (g->k_checks && 0 == (i + 1) % g->k_checks) {
+			chess_checkpoint cp;
+			checkpoint(&at, i + 1, &cp);
+			if (memcmp(&cp, &checks[(i + 1) / g->k_checks - 1], sizeof cp) != 0)
+				return false;
+		}
+	}
+	return true;
+}
+
+/*
+ * puts back a game chess_serialize() wrote, len being how much of it
+ * there is to read. chess must be a game already, from reset() or the
+ * pool, and becomes the one saved. every move is checked against the
+ * position it was played in. returns 0, or -1 if buf doesn't hold a whole
+ * game or a move in it doesn't play as saved, in which case chess is left
+ * as it was
+ */
+int chess_deserialize(chess_t *chess, const void *buf, size_t len) {
+	const saved_game *g = buf;
+	if (len < sizeof *g || memcmp(g->magic, GAME_MAGIC, GAME_MAGIC_LEN) != 0 || g->size > len)
+		return -1;
+	if (g->n_plies > g->end_plies || g->end_plies > g->size / sizeof(saved_ply) || g->n_checks > g->size / sizeof(chess_checkpoint)
+			|| g->size != sizeof *g + g->end_plies * sizeof(saved_ply) + g->n_checks * sizeof(chess_checkpoint))
+		return -1;
+	const saved_ply *sp = (const saved_ply *) (g + 1);
+	for (unsigned int i = 0; i < g->end_plies; ++i)
+		if (!saved_ply_ok(&sp[i]))
+			return -1;
+	chess_t start = *chess, now = *chess;
+	if (restore(&start, &g->start.pos, g->start.moves) < 0 || restore(&now, &g->now.pos, g->now.moves) < 0)
+		return -1;
+	start.halfmoves = g->start.halfmoves;
+	now.halfmoves = g->now.halfmoves;
+	if (!saved_plies_play(&start, &now, g))
+		return -1;
+	*chess = start;
+	arena_restart(chess);
+	struct chess_arena *arena = chess->arena;
+	if (g->end_plies) {
+		arena->cap_plies = (g->end_plies + ARENA_PLIES - 1) / ARENA_PLIES * ARENA_PLIES;
+		arena->plies = arena_alloc(arena, arena->cap_plies * sizeof *arena->plies);
+	}
+	for (unsigned int i = 0; i < g->end_plies; ++i) {
+		ply_t *p = &arena->plies[i];
+		p->move = (move_t) { .x = sp[i].x, .y = sp[i].y, .tx = sp[i].tx, .ty = sp[i].ty,
+			.piece = sp[i].piece, .promote = sp[i].promote, .flags = sp[i].flags };
+		p->result = sp[i].result;
+		p->taken = (chess_piece) { .pi = sp[i].taken, .c = sp[i].taken_c };
+		p->ep = sp[i].ep;
+		p->kpos[0] = sp[i].kpos[0];
+		p->kpos[1] = sp[i].kpos[1];
+		p->castle = sp[i].castle;
+		p->check = sp[i].check;
+		p->hash = sp[i].hash;
+		// the clock isn't saved with each ply, it follows from the one before
+		p->halfmoves = halfmoves_at(arena, i);
+	}
+	arena->n_plies = g->n_plies;
+	arena->end_plies = g->end_plies;
+	if (g->n_checks) {
+		arena->cap_checks = g->n_checks;
+		arena->checks = arena_alloc(arena, g->n_checks * sizeof *arena->checks);
+		memcpy(arena->checks, sp + g->end_plies, g->n_checks * sizeof *arena->checks);
+	}
+	arena->n_checks = g->n_checks;
+	arena->k_checks = g->k_checks;
+	*chess = now;
+	return 0;
+}
+
+/*
+ * packs the position into out, which needs room for CHESS_PACKED_MAX
+ * bytes, with label in the top four bits of the last byte. returns how
+ * many bytes it took
+ */
+size_t chess_pack_position(const chess_t *chess, unsigned int label, unsigned char *out) {
+	uint64_t occ = occupancy(chess->pieces);
+	for (int i = 0; i < 8; ++i)
+		out[i] = occ >> (8 * i);
+	size_t n = 8;
+	int nibbles = 0;
+	for (uint64_t left = occ; left; left &= left - 1, ++nibbles) {
+		int sq = __builtin_ctzll(left);
+		chess_piece p = chess->b[sq / BOARD_LENGTH][sq % BOARD_LENGTH];
+		int nibble = p.pi | p.c << 3;
+		if (nibbles % 2)
+			out[n++] |= nibble << 4;
+		else
+			out[n] = nibble;
+	}
+	if (nibbles % 2)
+		n++;
+	out[n++] = chess->turn | (chess->castle & 0xf) << 1;
+	out[n++] = (ep_file(chess->b) + 1) | (label & 0xf) << 4;
+	return n;
+}
+
+/*
+ * sets chess, which must be a game already, to a position packed by
+ * chess_pack_position() from the len bytes at in, starting the game over
+ * from there. label is set to the label packed with it if not NULL.
+ * returns how many bytes it read, or 0 if they don't hold a position
+ */
+size_t chess_unpack_position(chess_t *chess, const unsigned char *in, size_t len, unsigned int *label) {
+	if (len < 8)
+		return 0;
+	uint64_t occ = 0;
+	for (int i = 0; i < 8; ++i)
+		occ |= (uint64_t) in[i] << (8 * i);
+	int pieces = __builtin_popcountll(occ);
+	size_t n = 8 + (pieces + 1) / 2;
+	if (len < n + 2)
+		return 0;
+	chess_checkpoint cp = { .ep = -1 };
+	int i = 0;
+	for (uint64_t left = occ; left; left &= left - 1, ++i) {
+		int sq = __builtin_ctzll(left);
+		int nibble = in[8 + i / 2] >> (i % 2 * 4) & 0xf;
+		if ((nibble & 7) >= CHESS_NUM_PIECES)
+			return 0;
+		// a checkpoint counts pieces from one
+		cp.squares[sq / 2] |= (nibble + 1) << (sq % 2 * 4);
+	}
+	cp.turn = in[n] & 1;
+	cp.castle = in[n] >> 1 & 0xf;
+	int file = (in[n + 1] & 0xf) - 1;
+	if (file >= BOARD_LENGTH)
+		return 0;
+	// the phantom sits behind the pawn that just moved two squares
+	if (file >= 0)
+		cp.ep = (cp.turn ? 5 : 2) * BOARD_LENGTH + file;
+	chess_t at = *chess;
+	if (restore(&at, &cp, chess->moves) < 0)
+		return 0;
+	*chess = at;
+	arena_restart(chess);
+	if (NULL != label)
+		*label = in[n + 1] >> 4;
+	return n + 2;
+}
+
+// adds the move to out, once for each piece a pawn can promote to on the far rank
+static size_t add_candidate(const chess_t *chess, chess_move *out, int x, int y, int tx, int ty) {
+	static const chess_p promotions[] = { QUEEN, KNIGHT, ROOK, BISHOP };
+	bool promoting = PAWN == chess->b[y][x].pi && ty == (BOARD_HEIGHT - 1) * chess->turn;
+	for (int i = 0; i < (promoting ? 4 : 1); ++i)
+		out[i] = (chess_move) { .x = x, .y = y, .tx = tx, .ty = ty, .promote = promoting ? promotions[i] : BLANK };
+	return promoting ? 4 : 1;
+}
+
+/*
+ * the squares the piece p of the side to move on sq can go to by how it
+ * moves, king or no king. path gets every square that decides it: the
+ * ones it moves through or takes on, whatever is on them now
+ */
+static uint64_t piece_reach(const chess_t *chess, int p, int sq, uint64_t own, uint64_t empty, uint64_t *path) {
+	color turn = chess->turn;
+	uint64_t reach = 0;
+	switch (p) {
+		case PAWN: {
+			*path = 0;
+			int t = pawn_push[turn][sq];
+			if (t < 0)
+				break;
+			*path |= 1ULL << t;
+			if (empty >> t & 1) {
+				reach |= 1ULL << t;
+				t = pawn_double[turn][sq];
+				if (t >= 0 && (empty >> t & 1))
+					reach |= 1ULL << t;
+			}
+			if (pawn_double[turn][sq] >= 0)
+				*path |= 1ULL << pawn_double[turn][sq];
+			for (int i = 0; i < 2; ++i) {
+				t = pawn_take[turn][sq][i];
+				if (t < 0)
+					continue;
+				*path |= 1ULL << t;
+				chess_piece at = chess->b[t / BOARD_LENGTH][t % BOARD_LENGTH];
+				if (BLANK != at.pi && at.c != turn)
+					reach |= 1ULL << t;
+			}
+			return reach;
+		}
+		case KNIGHT:
+		case KING: {
+			uint64_t near = 0;
+			for (const int8_t *t = (KNIGHT == p) ? horse_sq[sq] : king_sq[sq]; *t >= 0; ++t)
+				near |= 1ULL << *t;
+			reach = near & ~own;
+			// test_move knows the rest of the castling rules
+			if (KING == p && sq == (BOARD_HEIGHT - 1) * swith(turn) * BOARD_LENGTH + 4)
+				reach |= 1ULL << (sq + 2) | 1ULL << (sq - 2);
+			// whether the king may go somewhere hangs on the whole board
+			*path = (KNIGHT == p) ? near : ~0ULL;
+			return reach;
+		}
+		default: {
+			uint64_t from = 1ULL << sq;
+			*path = slider_attacks((BISHOP == p) ? 0 : from, (ROOK == p) ? 0 : from, empty);
+			return *path & ~own;
+		}
+	}
+	return reach;
+}
+
+// the squares where a move by a piece of type p takes something or promotes
+static uint64_t tactical_squares(const chess_t *chess, int p, uint64_t enemy) {
+	if (PAWN != p)
+		return enemy;
+	int ep = ep_square(chess->b);
+	uint64_t far = 0xffULL << (BOARD_HEIGHT - 1) * chess->turn * BOARD_LENGTH;
+	return enemy | far | ((ep >= 0) ? 1ULL << ep : 0);
+}
+
+/*
+ * fills out with the side to move's moves that follow how the pieces move,
+ * without looking at whether they leave the king in check. tactical ones
+ * are captures, en passant included, and promotions; the rest are quiet,
+ * castles among them. out needs room for CHESS_MAX_CANDIDATES
+ */
+static size_t candidates(const chess_t *chess, chess_move *out, bool tactical) {
+	color turn = chess->turn;
+	uint64_t own = 0, enemy = 0;
+	for (int p = 0; p < CHESS_NUM_PIECES; ++p) {
+		own |= chess->pieces[turn][p];
+		enemy |= chess->pieces[swith(turn)][p];
+	}
+	uint64_t empty = ~(own | enemy);
+	size_t n = 0;
+	for (int p = 0; p < CHESS_NUM_PIECES; ++p) {
+		if (0 == chess->pieces[turn][p])
+			continue;
+		uint64_t hot = tactical_squares(chess, p, enemy);
+		for (uint64_t left = chess->pieces[turn][p]; left; left &= left - 1) {
+			int sq = __builtin_ctzll(left);
+			uint64_t path, reach = piece_reach(chess, p, sq, own, empty, &path);
+			for (reach &= tactical ? hot : ~hot; reach; reach &= reach - 1) {
+				int t = __builtin_ctzll(reach);
+				n += add_candidate(chess, out + n, sq % BOARD_LENGTH, sq / BOARD_LENGTH,
+						t % BOARD_LENGTH, t / BOARD_LENGTH);
+			}
+		}
+	}
+	return n;
+}
+
+static bool legal(chess_t *chess, const chess_move *m) {
+	move_t move;
+	board buf;
+	int kcopy[2];
+	castle_state cstate;
+	describe_move(chess, &move, m->x, m->y, m->tx, m->ty, m->promote);
+	return test_move(chess, &move, buf, kcopy, &cstate);
+}
+
+// every square along ray dir from sq, to the edge of the board
+static uint64_t ray_mask(int dir, int sq) {
+	uint64_t ret = 0;
+	for (const int8_t *t = ray_sq[dir][sq]; *t >= 0; ++t)
+		ret |= 1ULL << *t;
+	return ret;
+}
+
+// works out the targets of the side to move's pieces the cache lost since it was last asked
+static const struct move_cache *cache_fill(chess_t *chess) {
+	struct move_cache *mc = &chess->arena->cache;
+	if (mc->hash != chess->hash) {
+		mc->hash = chess->hash;
+		mc->valid[WHITE] = mc->valid[BLACK] = 0;
+	}
+	color turn = chess->turn;
+	uint64_t own = 0;
+	for (int p = 0; p < CHESS_NUM_PIECES; ++p)
+		own |= chess->pieces[turn][p];
+	uint64_t empty = ~occupancy(chess->pieces);
+	uint64_t far = 0xffULL << (BOARD_HEIGHT - 1) * turn * BOARD_LENGTH;
+	int ksq = chess->kpos[turn][1] * BOARD_LENGTH + chess->kpos[turn][0];
+	for (uint64_t left = own & ~mc->valid[turn]; left; left &= left - 1) {
+		int sq = __builtin_ctzll(left);
+		int x = sq % BOARD_LENGTH, y = sq / BOARD_LENGTH;
+		int p = chess->b[y][x].pi;
+		uint64_t path, reach = piece_reach(chess, p, sq, own, empty, &path);
+		uint64_t targets = 0;
+		for (; reach; reach &= reach - 1) {
+			int t = __builtin_ctzll(reach);
+			// a pawn may promote to one piece if it may to any
+			chess_move m = { .x = x, .y = y, .tx = t % BOARD_LENGTH, .ty = t / BOARD_LENGTH,
+				.promote = (PAWN == p && (far >> t & 1)) ? QUEEN : BLANK };
+			if (legal(chess, &m))
+				targets |= 1ULL << t;
+		}
+		uint64_t deps = path | 1ULL << sq | 1ULL << ksq;
+		for (int dir = 0; dir < 8; ++dir) {
+			uint64_t ray = ray_mask(dir, ksq);
+			if (ray >> sq & 1)
+				deps |= ray;
+		}
+		mc->targets[turn][sq] = targets;
+		mc->deps[turn][sq] = deps;
+	}
+	mc->valid[turn] |= own;
+	return mc;
+}
+
+/*
+ * fills out with every legal move for the side to move, which needs room
+ * for CHESS_MAX_MOVES, and returns how many there are. captures and
+ * promotions come first. only the pieces the moves since the last call
+ * could have affected are worked out again
+ */
+size_t chess_legal_moves(chess_t *chess, chess_move *out) {
+	size_t n = 0;
+	if (NULL == chess->arena) {
+		// a bare position, nothing to keep the targets in
+		chess_move found[CHESS_MAX_CANDIDATES];
+		for (int tactical = 1; tactical >= 0; --tactical) {
+			size_t len = candidates(chess, found, tactical);
+			for (size_t i = 0; i < len; ++i)
+				if (legal(chess, &found[i]))
+					out[n++] = found[i];
+		}
+		return n;
+	}
+	const struct move_cache *mc = cache_fill(chess);
+	color turn = chess->turn;
+	uint64_t enemy = 0;
+	for (int p = 0; p < CHESS_NUM_PIECES; ++p)
+		enemy |= chess->pieces[swith(turn)][p];
+	for (int tactical = 1; tactical >= 0; --tactical) {
+		for (int p = 0; p < CHESS_NUM_PIECES; ++p) {
+			if (0 == chess->pieces[turn][p])
+				continue;
+			uint64_t hot = tactical_squares(chess, p, enemy);
+			for (uint64_t left = chess->pieces[turn][p]; left; left &= left - 1) {
+				int sq = __builtin_ctzll(left);
+				uint64_t targets = mc->targets[turn][sq] & (tactical ? hot : ~hot);
+				for (; targets; targets &= targets - 1) {
+					int t = __builtin_ctzll(targets);
+					n += add_candidate(chess, out + n, sq % BOARD_LENGTH, sq / BOARD_LENGTH,
+							t % BOARD_LENGTH, t / BOARD_LENGTH);
+				}
+			}
+		}
+	}
+	return n;
+}
+
+/*
+ * the squares the piece on sq, numbered y * BOARD_LENGTH + x, can legally
+ * move to, one bit each. 0 if it isn't the side to move's. kept between
+ * moves like chess_legal_moves()
+ */
+uint64_t chess_targets(chess_t *chess, int sq) {
+	if (sq < 0 || sq >= BOARD_LENGTH * BOARD_HEIGHT)
+		return 0;
+	chess_piece at = chess->b[sq / BOARD_LENGTH][sq % BOARD_LENGTH];
+	if (at.pi < PAWN || at.c != chess->turn)
+		return 0;
+	return cache_fill(chess)->targets[chess->turn][sq];
+}
+
+// how many legal moves the side to move has, each promotion counted once per piece
+size_t chess_mobility(chess_t *chess) {
+	const struct move_cache *mc = cache_fill(chess);
+	color turn = chess->turn;
+	uint64_t far = 0xffULL << (BOARD_HEIGHT - 1) * turn * BOARD_LENGTH;
+	uint64_t own = 0;
+	for (int p = 0; p < CHESS_NUM_PIECES; ++p)
+		own |= chess->pieces[turn][p];
+	size_t n = 0;
+	for (uint64_t left = own; left; left &= left - 1) {
+		int sq = __builtin_ctzll(left);
+		uint64_t targets = mc->targets[turn][sq];
+		n += __builtin_popcountll(targets);
+		if (chess->pieces[turn][PAWN] >> sq & 1)
+			n += 3 * __builtin_popcountll(targets & far);
+	}
+	return n;
+}
+
+// what a piece is worth when ordering captures, kings are never taken
+static const int worth[CHESS_NUM_PIECES] = { [PAWN] = 1, [KNIGHT] = 3, [BISHOP] = 3, [ROOK] = 5, [QUEEN] = 9 };
+
+// the most valuable victim first, taken by the least valuable attacker
+static int order(const chess_t *chess, const chess_move *m) {
+	chess_piece victim = chess->b[m->ty][m->tx];
+	int score = (victim.pi >= PAWN) ? worth[victim.pi] * 16 : (F_PAWN == victim.pi) ? 16 : 0;
+	if (BLANK != m->promote)
+		score += worth[m->promote] * 16;
+	return score - worth[chess->b[m->y][m->x].pi];
+}
+
+// starts handing out the legal moves for the position chess is in
+void chess_gen_init(chess_gen *gen, chess_t *chess) {
+	gen->chess = chess;
+	gen->stage = CHESS_GEN_TACTICAL;
+	gen->n = candidates(chess, gen->moves, true);
+	gen->next = 0;
+	for (size_t i = 0; i < gen->n; ++i)
+		gen->score[i] = order(chess, &gen->moves[i]);
+}
+
+/*
+ * gives the next legal move: captures and promotions best first, then the
+ * quiet moves, which are only generated once the others run out. each is
+ * only tested for legality as it is handed out. returns false when there
+ * are none left. the position must not change in between
+ */
+bool chess_gen_next(chess_gen *gen, chess_move *m) {
+	while (1) {
+		if (gen->next == gen->n) {
+			if (CHESS_GEN_QUIET == gen->stage)
+				return false;
+			gen->stage = CHESS_GEN_QUIET;
+			gen->n = candidates(gen->chess, gen->moves, false);
+			gen->next = 0;
+			continue;
+		}
+		if (CHESS_GEN_TACTICAL == gen->stage) {
+			// pick the best one left
+			size_t best = gen->next;
+			for (size_t i = best + 1; i < gen->n; ++i)
+				if (gen->score[i] > gen->score[best])
+					best = i;
+			chess_move tmp = gen->moves[best];
+			gen->moves[best] = gen->moves[gen->next];
+			gen->score[best] = gen->score[gen->next];
+			gen->moves[gen->next] = tmp;
+		}
+		*m = gen->moves[gen->next++];
+		if (legal(gen->chess, m))
+			return true;
+	}
+}
+
+// every piece of either color in occ that attacks sq, given only the pieces in occ stand
+static uint64_t attackers_to(const uint64_t sets[2][CHESS_NUM_PIECES], int sq, uint64_t occ) {
+	uint64_t ret = 0;
+	for (int c = WHITE; c <= BLACK; ++c) {
+		// a pawn attacks sq from where a pawn of the other color on sq would take
+		for (int i = 0; i < 2; ++i)
+			if (pawn_take[swith(c)][sq][i] >= 0)
+				ret |= sets[c][PAWN] & 1ULL << pawn_take[swith(c)][sq][i];
+	}
+	for (const int8_t *t = horse_sq[sq]; *t >= 0; ++t)
+		ret |= (sets[WHITE][KNIGHT] | sets[BLACK][KNIGHT]) & 1ULL << *t;
+	for (const int8_t *t = king_sq[sq]; *t >= 0; ++t)
+		ret |= (sets[WHITE][KING] | sets[BLACK][KING]) & 1ULL << *t;
+	uint64_t queens = sets[WHITE][QUEEN] | sets[BLACK][QUEEN];
+	uint64_t from = 1ULL << sq;
+	ret |= slider_attacks(from, 0, ~occ) & (sets[WHITE][ROOK] | sets[BLACK][ROOK] | queens);
+	ret |= slider_attacks(0, from, ~occ) & (sets[WHITE][BISHOP] | sets[BLACK][BISHOP] | queens);
+	return ret & occ;
+}
+
+/*
+ * static exchange evaluation: what the side with the piece on square from
+ * (y * BOARD_LENGTH + x) comes out with, in pawns, after taking on square
+ * to and both sides going on taking there, least valuable piece first,
+ * for as long as it pays. sliders lined up behind others join in as the
+ * ones in front are traded off. the first capture is taken to be legal,
+ * and pins and promotions aren't looked at. returns 0 if there is no
+ * piece on from
+ */
+int chess_see(const chess_t *chess, int from, int to) {
+	static const chess_p by_worth[CHESS_NUM_PIECES] = { PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING };
+	chess_piece mover = chess->b[from / BOARD_LENGTH][from % BOARD_LENGTH];
+	chess_piece victim = chess->b[to / BOARD_LENGTH][to % BOARD_LENGTH];
+	if (mover.pi < PAWN)
+		return 0;
+	// gain[d] is what the side taking d-th stands to win, if it stops there
+	int gain[32];
+	int d = 0;
+	gain[0] = (victim.pi >= PAWN) ? worth[victim.pi] : (F_PAWN == victim.pi && PAWN == mover.pi) ? worth[PAWN] : 0;
+	uint64_t occ = occupancy(chess->pieces);
+	// an en passant capture takes the pawn from beside the phantom
+	if (F_PAWN == victim.pi && PAWN == mover.pi)
+		occ &= ~(1ULL << (to + ((WHITE == victim.c) ? -BOARD_LENGTH : BOARD_LENGTH)));
+	chess_p on_square = mover.pi;
+	color side = mover.c;
+	uint64_t at = 1ULL << from;
+	while (1) {
+		occ &= ~at;
+		uint64_t attackers = attackers_to(chess->pieces, to, occ);
+		side = swith(side);
+		uint64_t own = 0;
+		int i;
+		for (i = 0; i < CHESS_NUM_PIECES; ++i)
+			if ((own = attackers & chess->pieces[side][by_worth[i]]))
+				break;
+		if (!own)
+			break;
+		// a king can't take a piece that is still defended
+		if (KING == by_worth[i] && (attackers & ~own))
+			break;
+		d++;
+		gain[d] = worth[on_square] - gain[d - 1];
+		on_square = by_worth[i];
+		at = own & -own;
+	}
+	// each side only takes when it comes out better than stopping
+	while (d > 0) {
+		if (-gain[d] < gain[d - 1])
+			gain[d - 1] = -gain[d];
+		d--;
+	}
+	return gain[0];
+}
+
+// below this many positions a batch isn't worth another thread
+#define BATCH_MIN 256
+
+typedef struct {
+	const chess_pos *positions;
+	chess_result *out;
+	size_t n;
+} batch_t;
+
+static chess_result classify(const chess_pos *pos) {
+	// a bare chess_t, only what the move generator looks at
+	chess_t chess;
+	memcpy(*chess.b, *pos->b, sizeof chess.b);
+	chess.arena = NULL;
+	chess.turn = pos->turn;
+	chess.castle = pos->castle;
+	rebuild_sets(&chess);
+	for (int c = 0; c < 2; ++c) {
+		uint64_t king = chess.pieces[c][KING];
+		if (0 == king || (king & (king - 1)))
+			return (chess_result) { .state = CHESS_ERR, .moves = 0 };
+		int sq = __builtin_ctzll(king);
+		chess.kpos[c][0] = sq % BOARD_LENGTH;
+		chess.kpos[c][1] = sq / BOARD_LENGTH;
+	}
+	color turn = chess.turn;
+	bool check = attacked(chess.b, swith(turn), chess.kpos[turn][0], chess.kpos[turn][1], -1, -1);
+	chess.check = check ? turn : NOCOLOR;
+	chess_move moves[CHESS_MAX_MOVES];
+	chess_result ret = { .moves = chess_legal_moves(&chess, moves) };
+	if (ret.moves)
+		ret.state = check ? CHESS_CHECK : CHESS_NORMAL;
+	else
+		ret.state = check ? CHESS_MATE : CHESS_STALE;
+	return ret;
+}
+
+static void *classify_range(void *arg) {
+	batch_t *batch = arg;
+	for (size_t i = 0; i < batch->n; ++i)
+		batch->out[i] = classify(&batch->positions[i]);
+	return NULL;
+}
+
+/*
+ * works out check, mate or stalemate and the number of legal moves for
+ * each of n positions, with no game or history behind any of them. the
+ * positions are split evenly between one thread per processor
+ */
+void chess_classify_batch(const chess_pos *positions, size_t n, chess_result *out) {
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t threads = (cpus > 0) ? (size_t) cpus : 1;
+	if (threads > n / BATCH_MIN)
+		threads = n / BATCH_MIN ? n / BATCH_MIN : 1;
+	pthread_t tids[threads];
+	batch_t batches[threads];
+	size_t start = 0;
+	for (size_t t = 0; t < threads; ++t) {
+		size_t len = n / threads + (t < n % threads);
+		batches[t] = (batch_t) { positions + start, out + start, len };
+		start += len;
+		// this thread takes the first share itself
+		if (t > 0 && pthread_create(&tids[t], NULL, classify_range, &batches[t]) != 0) {
+			// no thread to spare, do its share here
+			classify_range(&batches[t]);
+			batches[t].n = 0;
+		}
+	}
+	classify_range(&batches[0]);
+	for (size_t t = 1; t < threads; ++t)
+		if (batches[t].n)
+			pthread_join(tids[t], NULL);
+}
+
+// puts the pieces where a game starts
+static void setup(chess_t *chess_board) {
+	board tmp = BOARD_START(WHITE);
+	memcpy(*(chess_board->b), *tmp, sizeof chess_board->b);
+	chess_board->turn = WHITE;
+	chess_board->check = NOCOLOR;
+	chess_board->castle = B_CASTLE_KING | B_CASTLE_QUEEN | W_CASTLE_KING | W_CASTLE_QUEEN;
+	rebuild_sets(chess_board);
+	chess_board->kpos[0][0] = 4;
+	chess_board->kpos[0][1] = 7;
+	chess_board->kpos[1][0] = 4;
+	chess_board->kpos[1][1] = 0;
+	chess_board->moves = 0;
+	chess_board->halfmoves = 0;
+}
+
+void reset(chess_t *chess_board) {
+	setup(chess_board);
+	chess_board->arena = calloc(1, sizeof *chess_board->arena);
+	chess_board->arena->k_checks = CHESS_CHECKPOINT_PLIES;
+	arena_alloc(chess_board->arena, 0);
+	arena_restart(chess_board);
+}
+
+// sets chess up for the game r, false if it is over before its first move
+static bool replay_start(chess_t *chess, chess_replay *r) {
+	r->plies = 0;
+	r->hash = 0;
+	if (NULL == r->fen) {
+		setup(chess);
+		arena_restart(chess);
+	} else if (chess_load_fen(chess, r->fen) < 0) {
+		r->state = CHESS_ERR;
+		return false;
+	}
+	r->state = (NOCOLOR != chess->check) ? CHESS_CHECK : CHESS_NORMAL;
+	r->hash = chess->hash;
+	return true;
+}
+
+// plays the move of r's history at *at, false once the game is over
+static bool replay_step(chess_t *chess, chess_replay *r, const char **at) {
+	while (1) {
+		while (' ' == **at)
+			(*at)++;
+		const char *san = *at;
+		size_t len = strcspn(san, " ");
+		*at += len;
+		if (0 == len)
+			return false;
+		// move numbers, "12." or "12..."
+		if ('.' != san[len - 1]) {
+			char buf[SAN_MAX + 1];
+			if (len > SAN_MAX) {
+				r->state = CHESS_ERR_PARSE;
+				return false;
+			}
+			memcpy(buf, san, len);
+			buf[len] = '\0';
+			chess_return ret = move(chess, buf);
+			r->state = ret;
+			if (ret < 0)
+				return false;
+			r->plies++;
+			r->hash = chess->hash;
+			return true;
+		}
+	}
+}
+
+// starts the next of the n games that has a move to play on chess, false if none are left
+static bool replay_next(chess_t *chess, chess_replay **r, const char **at, chess_replay *games, size_t n, size_t *next) {
+	while (*next < n) {
+		*r = &games[(*next)++];
+		*at = (*r)->history;
+		if (replay_start(chess, *r))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * replays n games from their moves in SAN, checking every one. with lanes
+ * of 0 or 1 it is a loop over the games, one after the other, on one game
+ * set up again for each so its arena is reused. with more, up to
+ * CHESS_REPLAY_LANES, that many games are played in lockstep, a move of
+ * each in turn, and a lane whose game is over takes the next one. see
+ * chess_replay for what each game gets back
+ */
+void chess_replay_batch(chess_replay *games, size_t n, unsigned int lanes) {
+	// each lane's state in arrays of their own, walked in turn
+	chess_t chess[CHESS_REPLAY_LANES];
+	chess_replay *of[CHESS_REPLAY_LANES];
+	const char *at[CHESS_REPLAY_LANES];
+	if (0 == lanes)
+		lanes = 1;
+	if (lanes > CHESS_REPLAY_LANES)
+		lanes = CHESS_REPLAY_LANES;
+	size_t next = 0;
+	unsigned int live = 0;
+	for (unsigned int l = 0; l < lanes; ++l)
+		reset(&chess[l]);
+	while (live < lanes && replay_next(&chess[live], &of[live], &at[live], games, n, &next))
+		++live;
+	while (live > 0) {
+		for (unsigned int l = 0; l < live; ) {
+			if (replay_step(&chess[l], of[l], &at[l]) || replay_next(&chess[l], &of[l], &at[l], games, n, &next)) {
+				++l;
+				continue;
+			}
+			// nothing left for this lane, the last live one takes its place
+			chess_t done = chess[l];
+			--live;
+			chess[l] = chess[live];
+			of[l] = of[live];
+			at[l] = at[live];
+			chess[live] = done;
+		}
+	}
+	for (unsigned int l = 0; l < lanes; ++l)
+		cleanup(&chess[l]);
+}
+
+static pool_slot *slot_of(struct chess_arena *arena) {
+	return (pool_slot *) ((char *) arena - offsetof(pool_slot, arena));
+}
+
+static arena_block *slot_block(pool_slot *slot) {
+	return (arena_block *) ((char *) slot + SLOT_HEAD);
+}
+
+// the free list this thread uses, handed out in turn the first time it asks
+static int pool_list(void) {
+	static _Thread_local int list = -1;
+	static unsigned int next_list;
+	if (list < 0)
+		list = __atomic_fetch_add(&next_list, 1, __ATOMIC_RELAXED) % POOL_LISTS;
+	return list;
+}
+
+static pool_slot *pool_pop(chess_pool *pool, int i) {
+	pthread_mutex_lock(&pool->lists[i].lock);
+	pool_slot *slot = pool->lists[i].free;
+	if (NULL != slot)
+		pool->lists[i].free = slot->next;
+	pthread_mutex_unlock(&pool->lists[i].lock);
+	return slot;
+}
+
+static void pool_push(chess_pool *pool, int i, pool_slot *first, pool_slot *last) {
+	pthread_mutex_lock(&pool->lists[i].lock);
+	last->next = pool->lists[i].free;
+	pool->lists[i].free = first;
+	pthread_mutex_unlock(&pool->lists[i].lock);
+}
+
+// carves a new slab into slots, keeping one and putting the rest on list i
+static pool_slot *pool_grow(chess_pool *pool, int i) {
+	char *slab = malloc(POOL_SLAB * SLOT_SIZE);
+	if (NULL == slab)
+		return NULL;
+	pthread_mutex_lock(&pool->slab_lock);
+	void **slabs = realloc(pool->slabs, (pool->n_slabs + 1) * sizeof *slabs);
+	if (NULL != slabs) {
+		pool->slabs = slabs;
+		pool->slabs[pool->n_slabs++] = slab;
+	}
+	pthread_mutex_unlock(&pool->slab_lock);
+	if (NULL == slabs) {
+		free(slab);
+		return NULL;
+	}
+	for (int n = 1; n < POOL_SLAB - 1; ++n)
+		((pool_slot *) (slab + n * SLOT_SIZE))->next = (pool_slot *) (slab + (n + 1) * SLOT_SIZE);
+	pool_push(pool, i, (pool_slot *) (slab + SLOT_SIZE), (pool_slot *) (slab + (POOL_SLAB - 1) * SLOT_SIZE));
+	return (pool_slot *) slab;
+}
+
+// returns a new pool, NULL if it can't be allocated
+chess_pool *chess_pool_new(void) {
+	chess_pool *pool = calloc(1, sizeof *pool);
+	if (NULL == pool)
+		return NULL;
+	for (int i = 0; i < POOL_LISTS; ++i)
+		pthread_mutex_init(&pool->lists[i].lock, NULL);
+	pthread_mutex_init(&pool->slab_lock, NULL);
+	return pool;
+}
+
+/*
+ * returns a game set up at the starting position, as reset() would leave
+ * it, or NULL if no memory is left. it goes back to the pool on cleanup()
+ */
+chess_t *chess_pool_get(chess_pool *pool) {
+	int i = pool_list();
+	pool_slot *slot = pool_pop(pool, i);
+	// games ended on other threads pile up on their lists, look there before growing
+	for (int j = 1; NULL == slot && j < POOL_LISTS; ++j)
+		slot = pool_pop(pool, (i + j) % POOL_LISTS);
+	if (NULL == slot && NULL == (slot = pool_grow(pool, i)))
+		return NULL;
+	arena_block *b = slot_block(slot);
+	b->next = NULL;
+	b->size = ARENA_BLOCK;
+	b->used = 0;
+	slot->arena.blocks = b;
+	slot->arena.pool = pool;
+	slot->arena.k_checks = CHESS_CHECKPOINT_PLIES;
+	setup(&slot->chess);
+	slot->chess.arena = &slot->arena;
+	arena_restart(&slot->chess);
+	return &slot->chess;
+}
+
+// frees every slab, the games handed out from the pool must all be cleaned up
+void chess_pool_free(chess_pool *pool) {
+	for (size_t n = 0; n < pool->n_slabs; ++n)
+		free(pool->slabs[n]);
+	for (int i = 0; i < POOL_LISTS; ++i)
+		pthread_mutex_destroy(&pool->lists[i].lock);
+	pthread_mutex_destroy(&pool->slab_lock);
+	free(pool->slabs);
+	free(pool);
+}
+
+void cleanup (chess_t *chess_board)
+{
+	struct chess_arena *arena = chess_board->arena;
+	// a pooled game's oldest block came with its slot
+	arena_block *keep = (NULL != arena->pool) ? slot_block(slot_of(arena)) : NULL;
+	arena_block *b = arena->blocks;
+	while (keep != b) {
+		arena_block *next = b->next;
+		free(b);
+		b = next;
+	}
+	chess_board->arena = NULL;
+	if (NULL != arena->pool) {
+		pool_slot *slot = slot_of(arena);
+		pool_push(arena->pool, pool_list(), slot, slot);
+	} else {
+		free (arena);
+	}
+}
+
+/*
+ * returns the game so far in SAN, move numbers included. only the moves
+ * played since the last call are written out, into a buffer from the
+ * game's arena that stays valid until the game is reset or cleaned up
+ */
+const char *chess_history(chess_t *chess) {
+	struct chess_arena *arena = chess->arena;
+	size_t left = arena->n_plies - arena->h_plies;
+	// a FEN can start the count anywhere, so make room for the longest number
+	size_t digits = 1;
+	for (unsigned long long last = (arena->h_pos.moves + (unsigned long long) left) / 2 + 1; last >= 10; last /= 10)
+		digits++;
+	size_t need = arena->h_len + left * (SAN_MAX + NUM_MAX + digits) + 1;
+	if (need > arena->h_cap) {
+		size_t cap = (2 * arena->h_cap > need) ? 2 * arena->h_cap : need;
+		char *history = arena_alloc(arena, cap);
+		if (arena->h_len)
+			memcpy(history, arena->history, arena->h_len);
+		arena->history = history;
+		arena->h_cap = cap;
+	}
+	chess_t *pos = &arena->h_pos;
+	char *at = arena->history + arena->h_len;
+	for (; arena->h_plies < arena->n_plies; arena->h_plies++) {
+		move_t move = arena->plies[arena->h_plies].move;
+		size_t room = arena->h_cap - (at - arena->history);
+		if (WHITE == pos->turn)
+			at += snprintf(at, room, "%u. ", pos->moves / 2 + 1);
+		else if (0 == arena->h_plies)
+			at += snprintf(at, room, "%u... ", pos->moves / 2 + 1);
+		at += unparse_movement(at, &move, pos);
+		replay(pos, &move);
+	}
+	*at = '\0';
+	arena->h_len = at - arena->history;
+	return arena->history;
 }
 
 char *print_color(color c) {
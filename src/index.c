@@ -0,0 +1,70 @@
+#include "index.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// returns 0 on success, -1 if the file can't be mapped or isn't a whole index
+int chess_index_open(chess_index *index, const char *path) {
+	memset(index, 0, sizeof *index);
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	struct stat st;
+	if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(chess_index_header)) {
+		close(fd);
+		return -1;
+	}
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (MAP_FAILED == data)
+		return -1;
+	const chess_index_header *h = data;
+	size_t want = sizeof *h + h->n_positions * sizeof(chess_index_pos) + h->n_moves * sizeof(chess_index_move);
+	if (memcmp(h->magic, INDEX_MAGIC, INDEX_MAGIC_LEN) != 0 || want != (size_t) st.st_size) {
+		munmap(data, st.st_size);
+		return -1;
+	}
+	index->data = data;
+	index->size = st.st_size;
+	index->positions = (const chess_index_pos *) (index->data + sizeof *h);
+	index->moves = (const chess_index_move *) (index->positions + h->n_positions);
+	index->n_positions = h->n_positions;
+	index->n_moves = h->n_moves;
+	return 0;
+}
+
+// returns the entry for the position with this hash, NULL if it was never reached
+const chess_index_pos *chess_index_probe(const chess_index *index, uint64_t hash) {
+	size_t lo = 0, hi = index->n_positions;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (index->positions[mid].hash < hash)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < index->n_positions && index->positions[lo].hash == hash)
+		return &index->positions[lo];
+	return NULL;
+}
+
+uint16_t chess_index_pack(const chess_move *m) {
+	int promote = (m->promote > PAWN) ? m->promote : 0;
+	return (m->y * BOARD_LENGTH + m->x) | (m->ty * BOARD_LENGTH + m->tx) << 6 | promote << 12;
+}
+
+void chess_index_unpack(uint16_t packed, chess_move *m) {
+	m->x = (packed & 63) % BOARD_LENGTH;
+	m->y = (packed & 63) / BOARD_LENGTH;
+	m->tx = (packed >> 6 & 63) % BOARD_LENGTH;
+	m->ty = (packed >> 6 & 63) / BOARD_LENGTH;
+	m->promote = (packed >> 12 & 7) ? (chess_p) (packed >> 12 & 7) : BLANK;
+}
+
+void chess_index_close(chess_index *index) {
+	if (NULL != index->data)
+		munmap((void *) index->data, index->size);
+	memset(index, 0, sizeof *index);
+}
@@ -0,0 +1,783 @@
+/*
+ * chess-index: builds a position index out of games in PGN, and looks
+ * positions up in one. it can also export every position of the games,
+ * or just check that every move in them is legal.
+ *
+ *	chess-index build [-m MB] INDEX [PGN ...]
+ *	chess-index probe INDEX [FEN]
+ *	chess-index export [-c MB] PREFIX [PGN ...]
+ *	chess-index verify [-l LANES] [PGN ...]
+ *	chess-index book [-m MB] [-d PLIES] BOOK [PGN ...]
+ *
+ * Building replays every game through move() and notes the hash of each
+ * position it reaches, the move played from there and how the game ended.
+ * Notes pile up in memory until they reach MB megabytes, then get sorted,
+ * folded together and written out as a run in a temporary file. The runs
+ * are merged into the index at the end, so the corpus can be far bigger
+ * than memory. See index.h for the layout of the index.
+ *
+ * Exporting writes each position every game reached, packed by
+ * chess_pack_position() with how the game ended as its label: 0 if white
+ * won, 1 drawn, 2 black won, 3 unfinished. The positions go into
+ * PREFIX-00000.pos, PREFIX-00001.pos and so on, each no bigger than MB
+ * megabytes unless one game alone is. A game never spans two files.
+ *
+ * Verifying gathers the games' moves as text and hands them to
+ * chess_replay_batch() VERIFY_BATCH games at a time, LANES of them played
+ * in lockstep, VERIFY_LANES unless told otherwise. Each game that
+ * doesn't replay to the end is reported with how far it got, and the exit
+ * status is 1 if there were any.
+ *
+ * A book is gathered the same way as an index, keeping only the moves
+ * played in the first PLIES plies of each game, 30 unless told otherwise.
+ * Each move is weighted by how many games played it. See book.h for the
+ * layout.
+ */
+#include "chess.h"
+#include "book.h"
+#include "index.h"
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LINE_LEN 16384
+#define DEFAULT_MB 256
+#define DEFAULT_CHUNK_MB 64
+#define DEFAULT_BOOK_PLIES 30
+#define IO_BUF (1 << 20)
+#define VERIFY_BATCH 4096
+#define VERIFY_LANES 1
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+enum { WHITE_WON, DRAWN, BLACK_WON, UNFINISHED };
+
+// one position and move, and the games that played it
+typedef struct {
+	uint64_t hash;
+	uint32_t games, white, draws, black;
+	uint16_t move;
+} tally;
+
+typedef struct {
+	FILE *f;
+	tally t;
+} run;
+
+static tally *pending;
+static size_t n_pending, max_pending;
+static run *runs;
+static size_t n_runs;
+
+// the game being read: where it is and what it went through so far
+static chess_t chess;
+static tally *plies;
+static size_t n_plies, cap_plies;
+static bool in_game, broken;
+static unsigned long games_read, games_bad;
+
+// when making a book, the moves are packed the way a book has them, and
+// only those played in the first book_plies plies are kept
+static bool booking;
+static unsigned long book_plies;
+
+// when exporting, the game's positions as packed so far and where they go
+static bool exporting;
+static unsigned char *packed;
+static size_t n_packed, cap_packed;
+static const char *prefix;
+static FILE *chunk;
+static size_t chunk_len, chunk_max;
+static unsigned int n_chunks;
+static unsigned long long positions_written;
+
+// when verifying, the games read but not yet replayed: their FEN and
+// moves, as offsets into text. fen is SIZE_MAX for the usual start
+static bool verifying;
+static char *text;
+static size_t n_text, cap_text;
+static struct {
+	size_t fen, moves;
+} queued[VERIFY_BATCH];
+static size_t n_queued;
+static unsigned int verify_lanes = VERIFY_LANES;
+static unsigned long long plies_replayed;
+static double replay_secs;
+
+static int by_position(const void *a, const void *b) {
+	const tally *x = a, *y = b;
+	if (x->hash != y->hash)
+		return (x->hash > y->hash) - (x->hash < y->hash);
+	return x->move - y->move;
+}
+
+static int by_games(const void *a, const void *b) {
+	const tally *x = a, *y = b;
+	return (x->games < y->games) - (x->games > y->games);
+}
+
+static void fold(tally *into, const tally *t) {
+	into->games += t->games;
+	into->white += t->white;
+	into->draws += t->draws;
+	into->black += t->black;
+}
+
+// sorts the notes in memory, folds repeats together and writes them out as a run
+static int spill(void) {
+	if (0 == n_pending)
+		return 0;
+	qsort(pending, n_pending, sizeof *pending, by_position);
+	size_t n = 0;
+	for (size_t i = 0; i < n_pending; ++i) {
+		if (n > 0 && 0 == by_position(&pending[n - 1], &pending[i]))
+			fold(&pending[n - 1], &pending[i]);
+		else
+			pending[n++] = pending[i];
+	}
+	FILE *f = tmpfile();
+	if (NULL == f)
+		return -1;
+	if (fwrite(pending, sizeof *pending, n, f) != n || fflush(f) != 0) {
+		fclose(f);
+		return -1;
+	}
+	rewind(f);
+	runs = realloc(runs, (n_runs + 1) * sizeof *runs);
+	runs[n_runs++].f = f;
+	n_pending = 0;
+	return 0;
+}
+
+// notes the position the game has reached
+static void add_ply(void) {
+	plies[n_plies++] = (tally) { .hash = chess.hash };
+	if (!exporting)
+		return;
+	if (cap_packed - n_packed < CHESS_PACKED_MAX) {
+		cap_packed *= 2;
+		packed = realloc(packed, cap_packed);
+	}
+	n_packed += chess_pack_position(&chess, UNFINISHED, packed + n_packed);
+}
+
+static void add_text(const char *s, size_t len) {
+	while (cap_text - n_text < len) {
+		cap_text *= 2;
+		text = realloc(text, cap_text);
+	}
+	memcpy(text + n_text, s, len);
+	n_text += len;
+}
+
+// a new game starts from fen, START_FEN unless the game's tags say otherwise
+static void start_game(const char *fen) {
+	in_game = true;
+	n_plies = 0;
+	n_packed = 0;
+	if (verifying) {
+		// the FEN is read when the game is replayed, until then it only counts as a ply
+		queued[n_queued].fen = SIZE_MAX;
+		if (strcmp(fen, START_FEN) != 0) {
+			queued[n_queued].fen = n_text;
+			add_text(fen, strlen(fen) + 1);
+		}
+		queued[n_queued].moves = n_text;
+		broken = false;
+		n_plies = 1;
+		return;
+	}
+	broken = chess_load_fen(&chess, fen) < 0;
+	if (broken)
+		return;
+	add_ply();
+}
+
+// writes the game's positions out with the result, starting a new chunk when this one is full
+static int export_game(int result) {
+	for (size_t at = 0, len; at < n_packed; at += len) {
+		uint64_t occ = 0;
+		for (int i = 0; i < 8; ++i)
+			occ |= (uint64_t) packed[at + i] << (8 * i);
+		len = 8 + (__builtin_popcountll(occ) + 1) / 2 + 2;
+		packed[at + len - 1] = (packed[at + len - 1] & 0xf) | result << 4;
+	}
+	if (NULL != chunk && chunk_len + n_packed > chunk_max) {
+		if (fclose(chunk) != 0)
+			return -1;
+		chunk = NULL;
+	}
+	if (NULL == chunk) {
+		char path[4096];
+		snprintf(path, sizeof path, "%s-%05u.pos", prefix, n_chunks++);
+		if (NULL == (chunk = fopen(path, "wb")))
+			return -1;
+		setvbuf(chunk, NULL, _IOFBF, IO_BUF);
+		chunk_len = 0;
+	}
+	if (fwrite(packed, 1, n_packed, chunk) != n_packed)
+		return -1;
+	chunk_len += n_packed;
+	positions_written += n_plies;
+	return 0;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// replays the games queued up and reports the ones that don't hold up
+static void verify_queued(void) {
+	static chess_replay games[VERIFY_BATCH];
+	for (size_t i = 0; i < n_queued; ++i)
+		games[i] = (chess_replay) { .fen = (SIZE_MAX == queued[i].fen) ? NULL : text + queued[i].fen,
+			.history = text + queued[i].moves };
+	double start = now();
+	chess_replay_batch(games, n_queued, verify_lanes);
+	replay_secs += now() - start;
+	for (size_t i = 0; i < n_queued; ++i) {
+		plies_replayed += games[i].plies;
+		if (games[i].state >= 0)
+			continue;
+		fprintf(stderr, "game %lu: stopped after %u plies (%d)\n", games_read + i + 1, games[i].plies, games[i].state);
+		games_bad++;
+	}
+	games_read += n_queued;
+	n_queued = 0;
+	n_text = 0;
+}
+
+static int end_game(int result) {
+	if (!in_game)
+		return 0;
+	in_game = false;
+	if (verifying) {
+		add_text("", 1);
+		if (++n_queued == VERIFY_BATCH)
+			verify_queued();
+		return 0;
+	}
+	if (broken) {
+		games_bad++;
+		return 0;
+	}
+	games_read++;
+	if (exporting)
+		return export_game(result);
+	size_t n = (booking && n_plies > book_plies) ? book_plies : n_plies;
+	for (size_t i = 0; i < n; ++i) {
+		if (n_pending == max_pending && spill() < 0)
+			return -1;
+		tally *t = &pending[n_pending++];
+		*t = plies[i];
+		t->games = 1;
+		t->white = WHITE_WON == result;
+		t->draws = DRAWN == result;
+		t->black = BLACK_WON == result;
+	}
+	return 0;
+}
+
+static void play(const char *notation) {
+	if (!in_game)
+		start_game(START_FEN);
+	if (verifying) {
+		add_text(notation, strlen(notation));
+		add_text(" ", 1);
+		n_plies++;
+		return;
+	}
+	if (broken)
+		return;
+	char buf[16];
+	snprintf(buf, sizeof buf, "%s", notation);
+	chess_move m;
+	// a book needs to know whether the king castled, which is easiest told before the move
+	chess_t before = chess;
+	if (move(&chess, buf) < CHESS_NORMAL || chess_last_move(&chess, &m) < 0) {
+		// the rest of the game can't be trusted, leave all of it out
+		broken = true;
+		return;
+	}
+	plies[n_plies - 1].move = booking ? chess_book_pack(&before, &m) : chess_index_pack(&m);
+	if (n_plies == cap_plies) {
+		cap_plies *= 2;
+		plies = realloc(plies, cap_plies * sizeof *plies);
+	}
+	add_ply();
+}
+
+static int result_of(const char *tok) {
+	if (strcmp(tok, "1-0") == 0)
+		return WHITE_WON;
+	if (strcmp(tok, "0-1") == 0)
+		return BLACK_WON;
+	if (strcmp(tok, "1/2-1/2") == 0)
+		return DRAWN;
+	if (strcmp(tok, "*") == 0)
+		return UNFINISHED;
+	return -1;
+}
+
+// strips a move number, annotations and '=' off a token, leaving what move() reads
+static char *clean(char *tok) {
+	char *p = tok;
+	while (isdigit(*p))
+		p++;
+	if ('.' == *p) {
+		while ('.' == *p)
+			p++;
+		tok = p;
+	}
+	size_t len = strlen(tok);
+	while (len > 0 && ('!' == tok[len - 1] || '?' == tok[len - 1]))
+		tok[--len] = '\0';
+	char *eq = strchr(tok, '=');
+	if (NULL != eq)
+		memmove(eq, eq + 1, strlen(eq));
+	return tok;
+}
+
+static int read_games(FILE *in) {
+	static char line[LINE_LEN];
+	// comments and variations can run over several lines
+	int comment = 0, variation = 0;
+	while (NULL != fgets(line, sizeof line, in)) {
+		if (0 == comment && '[' == *line) {
+			// a tag pair, the first one of a game closes any game left open
+			if (in_game && n_plies > 1 && end_game(UNFINISHED) < 0)
+				return -1;
+			char fen[128];
+			if (sscanf(line, "[FEN \"%127[^\"]\"]", fen) == 1)
+				start_game(fen);
+			else if (!in_game)
+				start_game(START_FEN);
+			continue;
+		}
+		char *save = NULL;
+		for (char *tok = strtok_r(line, " \t\r\n", &save); tok; tok = strtok_r(NULL, " \t\r\n", &save)) {
+			if (comment > 0 || '{' == *tok) {
+				comment += ('{' == *tok) - (NULL != strchr(tok, '}'));
+				if (comment < 0)
+					comment = 0;
+				continue;
+			}
+			if (';' == *tok)
+				break;
+			if ('(' == *tok || variation > 0) {
+				for (char *c = tok; *c; ++c)
+					variation += ('(' == *c) - (')' == *c);
+				continue;
+			}
+			if ('$' == *tok)
+				continue;
+			int result = result_of(tok);
+			if (result >= 0) {
+				if (end_game(result) < 0)
+					return -1;
+				continue;
+			}
+			char *m = clean(tok);
+			if (*m)
+				play(m);
+		}
+	}
+	return 0;
+}
+
+static int read_file(FILE *in, const char *name) {
+	setvbuf(in, NULL, _IOFBF, IO_BUF);
+	if (read_games(in) < 0 || end_game(UNFINISHED) < 0) {
+		perror(name);
+		return 1;
+	}
+	return 0;
+}
+
+static bool advance(run *r) {
+	return fread(&r->t, sizeof r->t, 1, r->f) == 1;
+}
+
+// keeps the run with the lowest next note at the top of the heap
+static void sift(run *heap, size_t n, size_t i) {
+	while (1) {
+		size_t least = i, l = 2 * i + 1, r = 2 * i + 2;
+		if (l < n && by_position(&heap[l].t, &heap[least].t) < 0)
+			least = l;
+		if (r < n && by_position(&heap[r].t, &heap[least].t) < 0)
+			least = r;
+		if (least == i)
+			return;
+		run tmp = heap[i];
+		heap[i] = heap[least];
+		heap[least] = tmp;
+		i = least;
+	}
+}
+
+// where write_index() puts what it merges
+typedef struct {
+	FILE *out, *moves;
+	chess_index_header h;
+} index_out;
+
+// writes one position's entry, and its moves most played first
+static int flush_position(tally *group, size_t n, void *arg) {
+	index_out *ix = arg;
+	if (0 == n)
+		return 0;
+	qsort(group, n, sizeof *group, by_games);
+	chess_index_pos pos = { .hash = group[0].hash, .first = ix->h.n_moves, .n_moves = n };
+	for (size_t i = 0; i < n; ++i) {
+		pos.games += group[i].games;
+		pos.white += group[i].white;
+		pos.draws += group[i].draws;
+		pos.black += group[i].black;
+		chess_index_move m = { .move = group[i].move, .games = group[i].games };
+		if (fwrite(&m, sizeof m, 1, ix->moves) != 1)
+			return -1;
+	}
+	if (fwrite(&pos, sizeof pos, 1, ix->out) != 1)
+		return -1;
+	ix->h.n_positions++;
+	ix->h.n_moves += n;
+	return 0;
+}
+
+/*
+ * merges the runs back together, handing each position's moves, with
+ * repeats folded, to flush in order of hash. returns -1 if flush did
+ */
+static int merge_runs(int (*flush)(tally *, size_t, void *), void *arg) {
+	size_t n = 0;
+	for (size_t i = 0; i < n_runs; ++i) {
+		setvbuf(runs[i].f, NULL, _IOFBF, IO_BUF / 4);
+		if (advance(&runs[i]))
+			runs[n++] = runs[i];
+		else
+			fclose(runs[i].f);
+	}
+	for (size_t i = n; i-- > 0;)
+		sift(runs, n, i);
+	// the moves of the position being merged, reusing the memory the notes had
+	tally *group = pending;
+	size_t n_group = 0;
+	int ret = 0;
+	while (n > 0 && 0 == ret) {
+		tally t = runs[0].t;
+		if (!advance(&runs[0])) {
+			fclose(runs[0].f);
+			runs[0] = runs[--n];
+		}
+		sift(runs, n, 0);
+		if (n_group > 0 && group[n_group - 1].hash == t.hash && group[n_group - 1].move == t.move) {
+			fold(&group[n_group - 1], &t);
+			continue;
+		}
+		if (n_group > 0 && group[n_group - 1].hash != t.hash) {
+			ret = flush(group, n_group, arg);
+			n_group = 0;
+		}
+		if (n_group == max_pending) {
+			ret = -1;
+			break;
+		}
+		group[n_group++] = t;
+	}
+	if (0 == ret && n_group > 0)
+		ret = flush(group, n_group, arg);
+	for (size_t i = 0; i < n; ++i)
+		fclose(runs[i].f);
+	return ret;
+}
+
+static int write_index(const char *path) {
+	index_out ix = { .out = fopen(path, "wb"), .moves = tmpfile() };
+	if (NULL == ix.out || NULL == ix.moves) {
+		if (ix.out)
+			fclose(ix.out);
+		return -1;
+	}
+	setvbuf(ix.out, NULL, _IOFBF, IO_BUF);
+	setvbuf(ix.moves, NULL, _IOFBF, IO_BUF);
+	memcpy(ix.h.magic, INDEX_MAGIC, INDEX_MAGIC_LEN);
+	// filled in again once the counts are known
+	fwrite(&ix.h, sizeof ix.h, 1, ix.out);
+	int ret = merge_runs(flush_position, &ix);
+
+	// the moves go after the positions
+	static char buf[IO_BUF];
+	size_t got;
+	rewind(ix.moves);
+	while (0 == ret && (got = fread(buf, 1, sizeof buf, ix.moves)) > 0)
+		if (fwrite(buf, 1, got, ix.out) != got)
+			ret = -1;
+	fclose(ix.moves);
+	if (0 == ret && (fseek(ix.out, 0, SEEK_SET) != 0 || fwrite(&ix.h, sizeof ix.h, 1, ix.out) != 1))
+		ret = -1;
+	if (fclose(ix.out) != 0)
+		ret = -1;
+	if (0 == ret)
+		printf("%lu games, %lu left out, %llu positions, %llu moves\n", games_read, games_bad,
+				(unsigned long long) ix.h.n_positions, (unsigned long long) ix.h.n_moves);
+	return ret;
+}
+
+// where write_book() puts what it merges
+typedef struct {
+	FILE *out;
+	unsigned long long positions, entries;
+} book_out;
+
+// writes a position's book entries, its moves most played first
+static int flush_entries(tally *group, size_t n, void *arg) {
+	book_out *book = arg;
+	qsort(group, n, sizeof *group, by_games);
+	book->positions++;
+	for (size_t i = 0; i < n; ++i) {
+		// the game ended here, that is no move to play
+		if (0 == group[i].move)
+			continue;
+		unsigned char e[CHESS_BOOK_ENTRY];
+		chess_book_entry(group[i].hash, group[i].move, group[i].games, e);
+		if (fwrite(e, sizeof e, 1, book->out) != 1)
+			return -1;
+		book->entries++;
+	}
+	return 0;
+}
+
+static int write_book(const char *path) {
+	book_out book = { .out = fopen(path, "wb") };
+	if (NULL == book.out)
+		return -1;
+	setvbuf(book.out, NULL, _IOFBF, IO_BUF);
+	int ret = merge_runs(flush_entries, &book);
+	if (fclose(book.out) != 0)
+		ret = -1;
+	if (0 == ret)
+		printf("%lu games, %lu left out, %llu positions, %llu entries\n", games_read, games_bad,
+				book.positions, book.entries);
+	return ret;
+}
+
+// notes what the games in the files after argv[0] played, and writes it out to argv[0]
+static int gather(int argc, char *argv[], size_t mb, int (*write)(const char *)) {
+	const char *path = argv[0];
+	max_pending = mb * 1024 * 1024 / sizeof *pending;
+	pending = malloc(max_pending * sizeof *pending);
+	cap_plies = 256;
+	plies = malloc(cap_plies * sizeof *plies);
+	if (NULL == pending || NULL == plies) {
+		fprintf(stderr, "chess-index: out of memory\n");
+		return 1;
+	}
+	reset(&chess);
+	int ret = (1 == argc) ? read_file(stdin, "stdin") : 0;
+	for (int i = 1; i < argc && 0 == ret; ++i) {
+		FILE *in = fopen(argv[i], "r");
+		if (NULL == in) {
+			perror(argv[i]);
+			ret = 1;
+			break;
+		}
+		ret = read_file(in, argv[i]);
+		fclose(in);
+	}
+	if (0 == ret && (spill() < 0 || write(path) < 0)) {
+		perror(path);
+		ret = 1;
+	}
+	cleanup(&chess);
+	free(plies);
+	free(pending);
+	free(runs);
+	return ret;
+}
+
+static int build(int argc, char *argv[]) {
+	size_t mb = DEFAULT_MB;
+	if (argc > 1 && strcmp(argv[0], "-m") == 0) {
+		mb = strtoul(argv[1], NULL, 10);
+		argv += 2;
+		argc -= 2;
+	}
+	if (argc < 1 || 0 == mb) {
+		fprintf(stderr, "usage: chess-index build [-m MB] INDEX [PGN ...]\n");
+		return 1;
+	}
+	return gather(argc, argv, mb, write_index);
+}
+
+static int book(int argc, char *argv[]) {
+	size_t mb = DEFAULT_MB;
+	book_plies = DEFAULT_BOOK_PLIES;
+	while (argc > 1 && '-' == argv[0][0]) {
+		if (strcmp(argv[0], "-m") == 0)
+			mb = strtoul(argv[1], NULL, 10);
+		else if (strcmp(argv[0], "-d") == 0)
+			book_plies = strtoul(argv[1], NULL, 10);
+		else
+			break;
+		argv += 2;
+		argc -= 2;
+	}
+	if (argc < 1 || 0 == mb || '-' == argv[0][0]) {
+		fprintf(stderr, "usage: chess-index book [-m MB] [-d PLIES] BOOK [PGN ...]\n");
+		return 1;
+	}
+	booking = true;
+	return gather(argc, argv, mb, write_book);
+}
+
+static void write_move(uint16_t packed, char buf[6]) {
+	static const char letters[] = " rnbq";
+	chess_move m;
+	chess_index_unpack(packed, &m);
+	buf[0] = 'a' + m.x;
+	buf[1] = '0' + BOARD_HEIGHT - m.y;
+	buf[2] = 'a' + m.tx;
+	buf[3] = '0' + BOARD_HEIGHT - m.ty;
+	buf[4] = (m.promote > PAWN && m.promote < KING) ? letters[m.promote] : '\0';
+	buf[5] = '\0';
+}
+
+static int probe(int argc, char *argv[]) {
+	if (argc < 1) {
+		fprintf(stderr, "usage: chess-index probe INDEX [FEN]\n");
+		return 1;
+	}
+	chess_index index;
+	if (chess_index_open(&index, argv[0]) < 0) {
+		fprintf(stderr, "unable to open index %s\n", argv[0]);
+		return 1;
+	}
+	reset(&chess);
+	int ret = 0;
+	if (argc > 1 && chess_load_fen(&chess, argv[1]) < 0) {
+		fprintf(stderr, "bad position %s\n", argv[1]);
+		ret = 1;
+	}
+	const chess_index_pos *pos = ret ? NULL : chess_index_probe(&index, chess.hash);
+	if (0 == ret && NULL == pos)
+		printf("position not in index\n");
+	if (NULL != pos) {
+		printf("%u games: white won %u, drawn %u, black won %u\n",
+				pos->games, pos->white, pos->draws, pos->black);
+		for (uint32_t i = 0; i < pos->n_moves; ++i) {
+			const chess_index_move *m = &index.moves[pos->first + i];
+			char buf[6];
+			write_move(m->move, buf);
+			printf("%-6s %10u %5.1f%%\n", m->move ? buf : "end", m->games, 100.0 * m->games / pos->games);
+		}
+	}
+	cleanup(&chess);
+	chess_index_close(&index);
+	return ret;
+}
+
+static int export(int argc, char *argv[]) {
+	size_t mb = DEFAULT_CHUNK_MB;
+	if (argc > 1 && strcmp(argv[0], "-c") == 0) {
+		mb = strtoul(argv[1], NULL, 10);
+		argv += 2;
+		argc -= 2;
+	}
+	if (argc < 1 || 0 == mb) {
+		fprintf(stderr, "usage: chess-index export [-c MB] PREFIX [PGN ...]\n");
+		return 1;
+	}
+	exporting = true;
+	prefix = argv[0];
+	chunk_max = mb * 1024 * 1024;
+	cap_plies = 256;
+	plies = malloc(cap_plies * sizeof *plies);
+	cap_packed = cap_plies * CHESS_PACKED_MAX;
+	packed = malloc(cap_packed);
+	if (NULL == plies || NULL == packed) {
+		fprintf(stderr, "chess-index: out of memory\n");
+		return 1;
+	}
+	reset(&chess);
+	int ret = (1 == argc) ? read_file(stdin, "stdin") : 0;
+	for (int i = 1; i < argc && 0 == ret; ++i) {
+		FILE *in = fopen(argv[i], "r");
+		if (NULL == in) {
+			perror(argv[i]);
+			ret = 1;
+			break;
+		}
+		ret = read_file(in, argv[i]);
+		fclose(in);
+	}
+	if (NULL != chunk && fclose(chunk) != 0 && 0 == ret) {
+		perror(prefix);
+		ret = 1;
+	}
+	if (0 == ret)
+		printf("%lu games, %lu left out, %llu positions in %u files\n", games_read, games_bad,
+				positions_written, n_chunks);
+	cleanup(&chess);
+	free(plies);
+	free(packed);
+	return ret;
+}
+
+static int verify(int argc, char *argv[]) {
+	if (argc > 1 && strcmp(argv[0], "-l") == 0) {
+		verify_lanes = strtoul(argv[1], NULL, 10);
+		argv += 2;
+		argc -= 2;
+	}
+	if (0 == verify_lanes || verify_lanes > CHESS_REPLAY_LANES) {
+		fprintf(stderr, "usage: chess-index verify [-l LANES] [PGN ...], LANES from 1 to %d\n", CHESS_REPLAY_LANES);
+		return 1;
+	}
+	verifying = true;
+	cap_text = IO_BUF;
+	if (NULL == (text = malloc(cap_text))) {
+		fprintf(stderr, "chess-index: out of memory\n");
+		return 1;
+	}
+	int ret = (0 == argc) ? read_file(stdin, "stdin") : 0;
+	for (int i = 0; i < argc && 0 == ret; ++i) {
+		FILE *in = fopen(argv[i], "r");
+		if (NULL == in) {
+			perror(argv[i]);
+			ret = 1;
+			break;
+		}
+		ret = read_file(in, argv[i]);
+		fclose(in);
+	}
+	if (0 == ret) {
+		verify_queued();
+		printf("%lu games, %lu failed, %llu plies replayed in %.3f s, %.0f games/s, %u lanes\n", games_read,
+				games_bad, plies_replayed, replay_secs, games_read / replay_secs, verify_lanes);
+	}
+	free(text);
+	return (0 == ret && games_bad > 0) ? 1 : ret;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc > 1 && strcmp(argv[1], "build") == 0)
+		return build(argc - 2, argv + 2);
+	if (argc > 1 && strcmp(argv[1], "probe") == 0)
+		return probe(argc - 2, argv + 2);
+	if (argc > 1 && strcmp(argv[1], "export") == 0)
+		return export(argc - 2, argv + 2);
+	if (argc > 1 && strcmp(argv[1], "verify") == 0)
+		return verify(argc - 2, argv + 2);
+	if (argc > 1 && strcmp(argv[1], "book") == 0)
+		return book(argc - 2, argv + 2);
+	fprintf(stderr, "usage: %s build [-m MB] INDEX [PGN ...]\n"
+			"       %s probe INDEX [FEN]\n"
+			"       %s export [-c MB] PREFIX [PGN ...]\n"
+			"       %s verify [-l LANES] [PGN ...]\n"
+			"       %s book [-m MB] [-d PLIES] BOOK [PGN ...]\n", argv[0], argv[0], argv[0], argv[0], argv[0]);
+	return 1;
+}
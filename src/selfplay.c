@@ -0,0 +1,200 @@
+/*
+ * chess-selfplay: plays random games as fast as it can, to load the
+ * rules engine and see how it scales.
+ *
+ *	chess-selfplay [-t THREADS] [-n GAMES] [-s SEED] [-p PLIES] [-w] [-o FILE]
+ *
+ * Each thread keeps its own game and takes the next game number from a
+ * shared counter. A game's moves only depend on the seed and its number,
+ * so the same seed plays the same games however many threads there are,
+ * and the checksum printed at the end shows it. Games run until mate,
+ * stalemate or PLIES plies. With -w captures and promotions are picked
+ * four times as often as other moves. With -o every game is written to
+ * FILE as PGN, in whatever order they finish.
+ */
+#include "chess.h"
+#include "writer.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_GAMES 10000
+#define DEFAULT_PLIES 400
+// how much likelier a capture or promotion is with -w
+#define TACTICAL_WEIGHT 4
+
+static struct {
+	unsigned long games;
+	uint64_t seed;
+	unsigned int plies;
+	bool weighted;
+	int fd;
+} opt = { DEFAULT_GAMES, 1, DEFAULT_PLIES, false, -1 };
+
+static atomic_ulong next_game;
+static chess_pool *pool;
+// the writer flushes partway through a game when full, so threads take turns with it
+static chess_writer out;
+static pthread_mutex_t out_lock = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct {
+	pthread_t thread;
+	unsigned long games, plies, mates, stalemates;
+	uint64_t checksum;
+	bool failed;
+} worker;
+
+// splitmix64, seeded once per game
+static uint64_t next_random(uint64_t *state) {
+	uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+static size_t pick(chess_t *game, const chess_move *moves, size_t n, uint64_t *rng) {
+	if (!opt.weighted)
+		return next_random(rng) % n;
+	unsigned int weights[CHESS_MAX_MOVES], total = 0;
+	for (size_t i = 0; i < n; ++i) {
+		chess_piece at = game->b[moves[i].ty][moves[i].tx];
+		bool tactical = BLANK != moves[i].promote || (at.pi >= PAWN && at.c != game->turn);
+		weights[i] = tactical ? TACTICAL_WEIGHT : 1;
+		total += weights[i];
+	}
+	unsigned int r = next_random(rng) % total;
+	size_t i = 0;
+	while (r >= weights[i])
+		r -= weights[i++];
+	return i;
+}
+
+static void *play_games(void *arg) {
+	worker *w = arg;
+	bool dump = opt.fd >= 0;
+	unsigned long i;
+	while ((i = atomic_fetch_add(&next_game, 1)) < opt.games) {
+		chess_t *game = chess_pool_get(pool);
+		if (NULL == game) {
+			w->failed = true;
+			break;
+		}
+		uint64_t rng = opt.seed ^ next_random(&(uint64_t) { i });
+		chess_return state = CHESS_NORMAL;
+		unsigned int ply;
+		for (ply = 0; ply < opt.plies && state != CHESS_MATE && state != CHESS_STALE; ++ply) {
+			chess_move moves[CHESS_MAX_MOVES];
+			size_t n = chess_legal_moves(game, moves);
+			const chess_move *m = &moves[pick(game, moves, n, &rng)];
+			state = chess_move_coord(game, m->x, m->y, m->tx, m->ty, m->promote);
+			if (state < 0) {
+				// a legal move the engine won't play is what this is here to find
+				fprintf(stderr, "game %lu, ply %u: move refused (%d)\n", i, ply + 1, state);
+				w->failed = true;
+				break;
+			}
+		}
+		w->games++;
+		w->plies += ply;
+		w->mates += CHESS_MATE == state;
+		w->stalemates += CHESS_STALE == state;
+		w->checksum ^= game->hash + i;
+		if (dump) {
+			char round[24];
+			snprintf(round, sizeof round, "%lu", i + 1);
+			chess_tags tags = { .event = "chess-selfplay", .round = round };
+			pthread_mutex_lock(&out_lock);
+			if (chess_write_game(&out, game, &tags) < 0)
+				w->failed = true;
+			pthread_mutex_unlock(&out_lock);
+		}
+		cleanup(game);
+		if (w->failed)
+			break;
+	}
+	return NULL;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+	long threads = sysconf(_SC_NPROCESSORS_ONLN);
+	int c;
+	while ((c = getopt(argc, argv, "t:n:s:p:wo:")) != -1) {
+		switch (c) {
+			case 't':
+				threads = atol(optarg);
+				break;
+			case 'n':
+				opt.games = strtoul(optarg, NULL, 10);
+				break;
+			case 's':
+				opt.seed = strtoull(optarg, NULL, 10);
+				break;
+			case 'p':
+				opt.plies = strtoul(optarg, NULL, 10);
+				break;
+			case 'w':
+				opt.weighted = true;
+				break;
+			case 'o':
+				opt.fd = open(optarg, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+				if (opt.fd < 0 || chess_writer_init(&out, opt.fd, CHESS_PGN, 0) < 0) {
+					perror(optarg);
+					return 1;
+				}
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-t THREADS] [-n GAMES] [-s SEED] [-p PLIES] [-w] [-o FILE]\n", argv[0]);
+				return 1;
+		}
+	}
+	if (threads < 1)
+		threads = 1;
+	pool = chess_pool_new();
+	worker *workers = calloc(threads, sizeof *workers);
+	if (NULL == pool || NULL == workers) {
+		fprintf(stderr, "chess-selfplay: out of memory\n");
+		return 1;
+	}
+
+	double start = now();
+	long started = 0;
+	for (; started < threads; ++started)
+		if (pthread_create(&workers[started].thread, NULL, play_games, &workers[started]) != 0)
+			break;
+	worker total = { 0 };
+	for (long i = 0; i < started; ++i) {
+		pthread_join(workers[i].thread, NULL);
+		total.games += workers[i].games;
+		total.plies += workers[i].plies;
+		total.mates += workers[i].mates;
+		total.stalemates += workers[i].stalemates;
+		total.checksum ^= workers[i].checksum;
+		total.failed |= workers[i].failed;
+	}
+	double secs = now() - start;
+
+	printf("%lu games, %lu plies in %.3f s on %ld threads\n", total.games, total.plies, secs, started);
+	printf("%.0f games/s, %.0f moves/s\n", total.games / secs, total.plies / secs);
+	printf("%lu mates, %lu stalemates, %lu hit the ply cap\n", total.mates, total.stalemates,
+			total.games - total.mates - total.stalemates);
+	printf("checksum %016llx\n", (unsigned long long) total.checksum);
+	if (opt.fd >= 0) {
+		total.failed |= chess_writer_free(&out) < 0;
+		close(opt.fd);
+	}
+	free(workers);
+	chess_pool_free(pool);
+	return (total.failed || 0 == started) ? 1 : 0;
+}
@@ -0,0 +1,450 @@
+/*
+ * chess-server: hosts many games at once for clients on a Unix socket.
+ *
+ *	chess-server [-s SNAPSHOT] [SOCKET]
+ *
+ * Clients send one command per line and get one line back for each, in
+ * order. Games belong to the server, not the connection, so any client
+ * can play on by id.
+ *
+ *	new			ok ID
+ *	move ID SAN		ok normal|check|mate|stalemate
+ *	state ID		ok normal|check|mate|stalemate FEN
+ *	history ID		ok MOVES
+ *	end ID			ok
+ *
+ * Anything that fails gets "err" and the reason instead. Every line that
+ * came in with one read is answered with one write.
+ *
+ * With -s, the games in SNAPSHOT are loaded back under their old ids on
+ * startup, and every game is written there on the way out.
+ */
+// for accept4
+#define _GNU_SOURCE
+#include "chess.h"
+#include "snapshot.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define DEFAULT_SOCKET "chess.sock"
+#define LINE_LEN 4096
+#define MAX_EVENTS 64
+#define GAMES_START 1024
+
+typedef struct {
+	int fd;
+	char in[LINE_LEN];
+	size_t in_len;
+	// replies not yet written, the connection isn't read from while there are any
+	char *out;
+	size_t out_len, out_cap, out_sent;
+	bool writing;
+} conn;
+
+// games by id, open addressed. id 0 marks an empty slot
+typedef struct {
+	uint32_t id;
+	chess_t *game;
+} entry;
+
+static struct {
+	entry *slots;
+	size_t cap, len;
+	uint32_t next_id;
+} games;
+
+static chess_pool *pool;
+static volatile sig_atomic_t stop;
+
+static size_t home(uint32_t id) {
+	return (id * 2654435761u) & (games.cap - 1);
+}
+
+static chess_t *find(uint32_t id) {
+	for (size_t i = home(id); games.slots[i].id; i = (i + 1) & (games.cap - 1))
+		if (games.slots[i].id == id)
+			return games.slots[i].game;
+	return NULL;
+}
+
+static void put(uint32_t id, chess_t *game) {
+	size_t i = home(id);
+	while (games.slots[i].id)
+		i = (i + 1) & (games.cap - 1);
+	games.slots[i].id = id;
+	games.slots[i].game = game;
+	games.len++;
+}
+
+/*
+ * hands out the next id no game holds. once the ids wrap around, the
+ * ones games from before still hold are skipped
+ */
+static uint32_t new_id(void) {
+	uint32_t id;
+	do {
+		id = games.next_id++;
+		if (0 == games.next_id)
+			games.next_id = 1;
+	} while (NULL != find(id));
+	return id;
+}
+
+// returns 0 on success, -1 if the table can't grow
+static int grow(void) {
+	entry *old = games.slots;
+	size_t old_cap = games.cap;
+	entry *slots = calloc(2 * old_cap, sizeof *slots);
+	if (NULL == slots)
+		return -1;
+	games.slots = slots;
+	games.cap = 2 * old_cap;
+	games.len = 0;
+	for (size_t i = 0; i < old_cap; ++i)
+		if (old[i].id)
+			put(old[i].id, old[i].game);
+	free(old);
+	return 0;
+}
+
+// takes the game out of the table, moving back any that probed past it
+static void drop(uint32_t id) {
+	size_t mask = games.cap - 1, i = home(id);
+	while (games.slots[i].id != id)
+		i = (i + 1) & mask;
+	for (size_t j = (i + 1) & mask; games.slots[j].id; j = (j + 1) & mask) {
+		size_t h = home(games.slots[j].id);
+		// j can fill the hole at i unless its home lies between them
+		if (((j - h) & mask) >= ((j - i) & mask)) {
+			games.slots[i] = games.slots[j];
+			i = j;
+		}
+	}
+	games.slots[i].id = 0;
+	games.len--;
+}
+
+static int reply(conn *c, const char *s) {
+	size_t n = strlen(s);
+	if (c->out_len + n + 1 > c->out_cap) {
+		size_t cap = c->out_cap ? 2 * c->out_cap : LINE_LEN;
+		while (cap < c->out_len + n + 1)
+			cap *= 2;
+		char *out = realloc(c->out, cap);
+		if (NULL == out)
+			return -1;
+		c->out = out;
+		c->out_cap = cap;
+	}
+	memcpy(c->out + c->out_len, s, n);
+	c->out[c->out_len + n] = '\n';
+	c->out_len += n + 1;
+	return 0;
+}
+
+static const char *state_name(chess_t *game) {
+	chess_gen gen;
+	chess_move m;
+	chess_gen_init(&gen, game);
+	bool any = chess_gen_next(&gen, &m);
+	if (NOCOLOR != game->check)
+		return any ? "check" : "mate";
+	return any ? "normal" : "stalemate";
+}
+
+static const char *error_name(chess_return err) {
+	switch (err) {
+		case CHESS_ERR_PARSE:
+			return "err not a valid move";
+		case CHESS_ERR_AMBIG:
+			return "err ambiguous move";
+		case CHESS_ERR_NOAVAIL:
+			return "err no piece can make that move";
+		case CHESS_ERR_ILLEGAL:
+			return "err illegal move";
+		case CHESS_ERR_PROMISE:
+			return "err move claims what it can't achieve";
+		default:
+			return "err unknown error";
+	}
+}
+
+// reads a game id, returning 0 if there isn't one
+static uint32_t parse_id(const char *s) {
+	if (NULL == s)
+		return 0;
+	char *end;
+	unsigned long id = strtoul(s, &end, 10);
+	return ('\0' == *end && id <= UINT32_MAX) ? id : 0;
+}
+
+static int command(conn *c, char *line) {
+	char buf[LINE_LEN + 64];
+	char *save;
+	char *cmd = strtok_r(line, " \t\r", &save);
+	if (NULL == cmd)
+		return 0;
+	if (strcmp(cmd, "new") == 0) {
+		if (4 * (games.len + 1) > 3 * games.cap && grow() < 0)
+			return reply(c, "err out of memory");
+		chess_t *game = chess_pool_get(pool);
+		if (NULL == game)
+			return reply(c, "err out of memory");
+		uint32_t id = new_id();
+		put(id, game);
+		snprintf(buf, sizeof buf, "ok %u", id);
+		return reply(c, buf);
+	}
+	bool known = strcmp(cmd, "move") == 0 || strcmp(cmd, "state") == 0
+		|| strcmp(cmd, "history") == 0 || strcmp(cmd, "end") == 0;
+	if (!known)
+		return reply(c, "err unknown command");
+	uint32_t id = parse_id(strtok_r(NULL, " \t\r", &save));
+	chess_t *game = id ? find(id) : NULL;
+	if (NULL == game)
+		return reply(c, "err no such game");
+
+	if (strcmp(cmd, "move") == 0) {
+		char *san = strtok_r(NULL, " \t\r", &save);
+		if (NULL == san)
+			return reply(c, "err no move given");
+		chess_return ret = move(game, san);
+		if (ret < 0)
+			return reply(c, error_name(ret));
+		snprintf(buf, sizeof buf, "ok %s", state_name(game));
+		return reply(c, buf);
+	}
+	if (strcmp(cmd, "state") == 0) {
+		char fen[CHESS_FEN_MAX];
+		chess_fen(game, fen);
+		snprintf(buf, sizeof buf, "ok %s %s", state_name(game), fen);
+		return reply(c, buf);
+	}
+	if (strcmp(cmd, "history") == 0) {
+		const char *history = chess_history(game);
+		size_t len = strlen(history);
+		char *out = malloc(len + 4);
+		if (NULL == out)
+			return reply(c, "err out of memory");
+		// the history ends in a space once a move has been made
+		if (len > 0 && ' ' == history[len - 1])
+			len--;
+		memcpy(out, "ok ", 3);
+		memcpy(out + 3, history, len);
+		out[len + 3] = '\0';
+		int ret = reply(c, out);
+		free(out);
+		return ret;
+	}
+	drop(id);
+	cleanup(game);
+	return reply(c, "ok");
+}
+
+// writes what it can of the replies. returns -1 if the connection is gone
+static int flush(conn *c) {
+	while (c->out_sent < c->out_len) {
+		ssize_t n = send(c->fd, c->out + c->out_sent, c->out_len - c->out_sent, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (EINTR == errno)
+				continue;
+			if (EAGAIN == errno || EWOULDBLOCK == errno)
+				return 0;
+			return -1;
+		}
+		c->out_sent += n;
+	}
+	c->out_len = c->out_sent = 0;
+	return 0;
+}
+
+// answers every whole line read so far. returns -1 if the connection should close
+static int serve(conn *c) {
+	ssize_t n = recv(c->fd, c->in + c->in_len, sizeof c->in - c->in_len, 0);
+	if (n < 0)
+		return (EINTR == errno || EAGAIN == errno || EWOULDBLOCK == errno) ? 0 : -1;
+	if (0 == n)
+		return -1;
+	c->in_len += n;
+	char *line = c->in, *nl;
+	while (NULL != (nl = memchr(line, '\n', c->in + c->in_len - line))) {
+		*nl = '\0';
+		if (command(c, line) < 0)
+			return -1;
+		line = nl + 1;
+	}
+	c->in_len -= line - c->in;
+	memmove(c->in, line, c->in_len);
+	// a line that can't fit the buffer will never be answered
+	if (c->in_len == sizeof c->in)
+		return -1;
+	return flush(c);
+}
+
+static void hang_up(int epfd, conn *c) {
+	epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+	close(c->fd);
+	free(c->out);
+	free(c);
+}
+
+// returns 0, or -1 if the snapshot is there but can't all be loaded
+static int load_games(const char *path) {
+	chess_snapshot snap;
+	if (chess_snapshot_open(&snap, path) < 0)
+		return (0 == access(path, F_OK)) ? -1 : 0;
+	int ret = 0;
+	for (size_t i = 0; i < snap.n_games && 0 == ret; ++i) {
+		uint64_t id = snap.games[i].id;
+		chess_t *game = NULL;
+		if (0 == id || id > UINT32_MAX || NULL != find(id))
+			ret = -1;
+		else if ((4 * (games.len + 1) > 3 * games.cap && grow() < 0) || NULL == (game = chess_pool_get(pool)))
+			ret = -1;
+		else if (chess_snapshot_load(&snap, i, game) < 0)
+			ret = -1;
+		if (ret < 0) {
+			if (NULL != game)
+				cleanup(game);
+			break;
+		}
+		put(id, game);
+		if (id >= games.next_id)
+			games.next_id = (id == UINT32_MAX) ? 1 : id + 1;
+	}
+	chess_snapshot_close(&snap);
+	return ret;
+}
+
+static int save_games(const char *path) {
+	uint64_t *ids = malloc((games.len + 1) * sizeof *ids);
+	chess_t **list = malloc((games.len + 1) * sizeof *list);
+	int ret = -1;
+	if (NULL != ids && NULL != list) {
+		size_t n = 0;
+		for (size_t i = 0; i < games.cap; ++i) {
+			if (games.slots[i].id) {
+				ids[n] = games.slots[i].id;
+				list[n++] = games.slots[i].game;
+			}
+		}
+		ret = chess_snapshot_write(path, ids, list, n);
+	}
+	free(ids);
+	free(list);
+	return ret;
+}
+
+static void on_signal(int sig) {
+	(void) sig;
+	stop = 1;
+}
+
+int main(int argc, char *argv[]) {
+	const char *snapshot = NULL;
+	if (argc > 2 && strcmp(argv[1], "-s") == 0) {
+		snapshot = argv[2];
+		argv += 2;
+		argc -= 2;
+	}
+	const char *path = (argc > 1) ? argv[1] : DEFAULT_SOCKET;
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	if (argc > 2 || strlen(path) >= sizeof addr.sun_path) {
+		fprintf(stderr, "usage: %s [-s SNAPSHOT] [SOCKET]\n", argv[0]);
+		return 1;
+	}
+	strcpy(addr.sun_path, path);
+
+	pool = chess_pool_new();
+	games.cap = GAMES_START;
+	games.slots = calloc(games.cap, sizeof *games.slots);
+	games.next_id = 1;
+	if (NULL == pool || NULL == games.slots) {
+		fprintf(stderr, "chess-server: out of memory\n");
+		return 1;
+	}
+	if (NULL != snapshot && load_games(snapshot) < 0) {
+		fprintf(stderr, "unable to load snapshot %s\n", snapshot);
+		return 1;
+	}
+
+	int lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	unlink(path);
+	if (lfd < 0 || bind(lfd, (struct sockaddr *) &addr, sizeof addr) < 0 || listen(lfd, SOMAXCONN) < 0) {
+		fprintf(stderr, "unable to listen on %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+	int epfd = epoll_create1(EPOLL_CLOEXEC);
+	struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+	if (epfd < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, lfd, &ev) < 0) {
+		fprintf(stderr, "chess-server: %s\n", strerror(errno));
+		return 1;
+	}
+
+	// no SA_RESTART, so epoll_wait returns to see stop
+	struct sigaction sa = { .sa_handler = on_signal };
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	struct epoll_event events[MAX_EVENTS];
+	while (!stop) {
+		int n = epoll_wait(epfd, events, MAX_EVENTS, -1);
+		if (n < 0) {
+			if (EINTR == errno)
+				continue;
+			fprintf(stderr, "chess-server: %s\n", strerror(errno));
+			break;
+		}
+		for (int i = 0; i < n; ++i) {
+			conn *c = events[i].data.ptr;
+			if (NULL == c) {
+				int fd;
+				while ((fd = accept4(lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+					c = calloc(1, sizeof *c);
+					struct epoll_event cev = { .events = EPOLLIN, .data.ptr = c };
+					if (NULL == c || epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &cev) < 0) {
+						close(fd);
+						free(c);
+						continue;
+					}
+					c->fd = fd;
+				}
+				continue;
+			}
+			int ret = (events[i].events & EPOLLOUT) ? flush(c) : serve(c);
+			if (ret < 0 || (events[i].events & (EPOLLHUP | EPOLLERR) && !(events[i].events & EPOLLIN))) {
+				hang_up(epfd, c);
+				continue;
+			}
+			// stop reading until a client that isn't reading catches up
+			if (c->writing != (c->out_len > 0)) {
+				c->writing = c->out_len > 0;
+				struct epoll_event cev = { .events = c->writing ? EPOLLOUT : EPOLLIN, .data.ptr = c };
+				epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &cev);
+			}
+		}
+	}
+
+	close(lfd);
+	unlink(path);
+	int ret = 0;
+	if (NULL != snapshot && save_games(snapshot) < 0) {
+		fprintf(stderr, "unable to write snapshot %s\n", snapshot);
+		ret = 1;
+	}
+	for (size_t i = 0; i < games.cap; ++i)
+		if (games.slots[i].id)
+			cleanup(games.slots[i].game);
+	free(games.slots);
+	chess_pool_free(pool);
+	return ret;
+}
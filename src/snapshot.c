@@ -0,0 +1,133 @@
+#include "snapshot.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int write_games(FILE *f, const chess_snapshot_entry *entries, chess_t *const *games, size_t n) {
+	chess_snapshot_header h = { .n_games = n };
+	memcpy(h.magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN);
+	if (fwrite(&h, sizeof h, 1, f) != 1 || fwrite(entries, sizeof *entries, n, f) != n)
+		return -1;
+	char *buf = NULL;
+	size_t cap = 0;
+	int ret = 0;
+	for (size_t i = 0; i < n && 0 == ret; ++i) {
+		if (entries[i].size > cap) {
+			char *more = realloc(buf, entries[i].size);
+			if (NULL == more) {
+				ret = -1;
+				break;
+			}
+			buf = more;
+			cap = entries[i].size;
+		}
+		chess_serialize(games[i], buf, cap);
+		if (fwrite(buf, entries[i].size, 1, f) != 1)
+			ret = -1;
+	}
+	free(buf);
+	if (0 == ret && (fflush(f) != 0 || fsync(fileno(f)) != 0))
+		ret = -1;
+	return ret;
+}
+
+/*
+ * writes the n games, each under the id beside it, to a snapshot at path.
+ * it goes to path.tmp first and is renamed over path once whole, so a
+ * crash leaves the last snapshot as it was. returns 0, or -1 on failure
+ */
+int chess_snapshot_write(const char *path, const uint64_t *ids, chess_t *const *games, size_t n) {
+	size_t len = strlen(path);
+	char *tmp = malloc(len + sizeof ".tmp");
+	chess_snapshot_entry *entries = malloc((n ? n : 1) * sizeof *entries);
+	FILE *f = NULL;
+	if (NULL != tmp) {
+		memcpy(tmp, path, len);
+		memcpy(tmp + len, ".tmp", sizeof ".tmp");
+		f = fopen(tmp, "wb");
+	}
+	if (NULL == f || NULL == entries) {
+		if (NULL != f) {
+			fclose(f);
+			unlink(tmp);
+		}
+		free(tmp);
+		free(entries);
+		return -1;
+	}
+	// every game is a multiple of 8 bytes long, so they all stay aligned
+	uint64_t offset = sizeof(chess_snapshot_header) + n * sizeof *entries;
+	for (size_t i = 0; i < n; ++i) {
+		entries[i].id = ids[i];
+		entries[i].offset = offset;
+		entries[i].size = chess_serialize(games[i], NULL, 0);
+		offset += entries[i].size;
+	}
+	int ret = write_games(f, entries, games, n);
+	if (fclose(f) != 0)
+		ret = -1;
+	if (0 == ret && rename(tmp, path) < 0)
+		ret = -1;
+	if (ret < 0)
+		unlink(tmp);
+	free(entries);
+	free(tmp);
+	return ret;
+}
+
+// returns 0 on success, -1 if the file can't be mapped or isn't a whole snapshot
+int chess_snapshot_open(chess_snapshot *snap, const char *path) {
+	memset(snap, 0, sizeof *snap);
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	struct stat st;
+	if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(chess_snapshot_header)) {
+		close(fd);
+		return -1;
+	}
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (MAP_FAILED == data)
+		return -1;
+	const chess_snapshot_header *h = data;
+	size_t size = st.st_size;
+	if (memcmp(h->magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN) != 0
+			|| h->n_games > (size - sizeof *h) / sizeof(chess_snapshot_entry)) {
+		munmap(data, size);
+		return -1;
+	}
+	const chess_snapshot_entry *games = (const chess_snapshot_entry *) (h + 1);
+	// chess_deserialize() reads each game in place, so it must be aligned as written
+	for (size_t i = 0; i < h->n_games; ++i) {
+		if (games[i].offset > size || games[i].size > size - games[i].offset || games[i].offset % 8 != 0) {
+			munmap(data, size);
+			return -1;
+		}
+	}
+	snap->data = data;
+	snap->size = size;
+	snap->games = games;
+	snap->n_games = h->n_games;
+	return 0;
+}
+
+/*
+ * puts game i of the snapshot into chess, which must be a game already,
+ * from reset() or the pool. returns 0, or -1 if the game is damaged
+ */
+int chess_snapshot_load(const chess_snapshot *snap, size_t i, chess_t *chess) {
+	if (i >= snap->n_games)
+		return -1;
+	return chess_deserialize(chess, snap->data + snap->games[i].offset, snap->games[i].size);
+}
+
+void chess_snapshot_close(chess_snapshot *snap) {
+	if (NULL != snap->data)
+		munmap((void *) snap->data, snap->size);
+	memset(snap, 0, sizeof *snap);
+}
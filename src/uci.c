@@ -0,0 +1,403 @@
+/*
+ * chess-uci: speaks the UCI protocol on stdin and stdout.
+ *
+ * The main thread only reads commands. Anything that touches the game is
+ * queued for the worker thread, which keeps one chess_t for as long as the
+ * GUI keeps extending the same game, so each position command only costs
+ * the moves that are new since the last one.
+ */
+#include "chess.h"
+#include <pthread.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LINE_LEN 16384
+#define MAX_PLIES 2048
+// share of the remaining clock spent on one move
+#define MOVES_TO_GO 30
+#define MAX_DEPTH 64
+// scores past this are mates, MATE_SCORE less the plies to it
+#define MATE_SCORE 100000
+// the clock is read once every so many nodes
+#define CLOCK_NODES 1024
+
+typedef struct command {
+	char *line;
+	struct command *next;
+} command;
+
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t ready;
+	command *head, *tail;
+} queue = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, NULL };
+
+static pthread_mutex_t out_lock = PTHREAD_MUTEX_INITIALIZER;
+/*
+ * gos counts the go commands read, stops is what gos was when the last
+ * stop came in. a search stops once stops reaches its own number, so a stop
+ * read before the worker gets to a go still ends it, and one read before a
+ * later go doesn't
+ */
+static atomic_uint gos, stops;
+
+// the worker's game, where it started from and the moves played since
+static chess_t game;
+static char base[LINE_LEN];
+static char played[MAX_PLIES][6];
+static int n_played;
+
+static void say(const char *fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	pthread_mutex_lock(&out_lock);
+	vprintf(fmt, args);
+	putchar('\n');
+	fflush(stdout);
+	pthread_mutex_unlock(&out_lock);
+	va_end(args);
+}
+
+static void push(const char *line) {
+	command *c = malloc(sizeof *c);
+	c->line = strdup(line);
+	c->next = NULL;
+	pthread_mutex_lock(&queue.lock);
+	if (NULL == queue.tail)
+		queue.head = c;
+	else
+		queue.tail->next = c;
+	queue.tail = c;
+	pthread_cond_signal(&queue.ready);
+	pthread_mutex_unlock(&queue.lock);
+}
+
+static char *pop(void) {
+	pthread_mutex_lock(&queue.lock);
+	while (NULL == queue.head)
+		pthread_cond_wait(&queue.ready, &queue.lock);
+	command *c = queue.head;
+	queue.head = c->next;
+	if (NULL == queue.head)
+		queue.tail = NULL;
+	pthread_mutex_unlock(&queue.lock);
+	char *line = c->line;
+	free(c);
+	return line;
+}
+
+static long now_ms(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void write_move(const chess_move *m, char buf[6]) {
+	static const char letters[] = " rnbq";
+	buf[0] = 'a' + m->x;
+	buf[1] = '0' + BOARD_HEIGHT - m->y;
+	buf[2] = 'a' + m->tx;
+	buf[3] = '0' + BOARD_HEIGHT - m->ty;
+	buf[4] = (m->promote > PAWN && m->promote < KING) ? letters[m->promote] : '\0';
+	buf[5] = '\0';
+}
+
+// plays a move in long algebraic form, e2e4 or e7e8q
+static bool apply(const char *lan) {
+	return chess_move_lan(&game, lan) >= CHESS_NORMAL;
+}
+
+// starts over from startpos or fen FEN, keeping the game it has if that is bad
+static bool new_game(const char *from) {
+	chess_t next;
+	reset(&next);
+	if (strcmp(from, "startpos") != 0 &&
+			(strncmp(from, "fen ", 4) != 0 || chess_load_fen(&next, from + 4) < 0)) {
+		say("info string bad position %s", from);
+		cleanup(&next);
+		return false;
+	}
+	cleanup(&game);
+	game = next;
+	strcpy(base, from);
+	n_played = 0;
+	return true;
+}
+
+/*
+ * position [startpos | fen FEN] [moves m1 m2 ...]
+ * the game carries on from where it is if the moves given start with the
+ * ones already played from the same starting point
+ */
+static void position(char *args) {
+	char *moves = strstr(args, " moves");
+	if (NULL != moves) {
+		*moves = '\0';
+		moves += strlen(" moves");
+	}
+	if (strcmp(args, base) != 0 && !new_game(args))
+		return;
+	char *save = NULL;
+	int i = 0;
+	for (char *m = moves ? strtok_r(moves, " ", &save) : NULL; m; m = strtok_r(NULL, " ", &save), ++i) {
+		if (i < n_played) {
+			if (strcmp(m, played[i]) == 0)
+				continue;
+			// the game went another way, take back to where it split
+			while (n_played > i && chess_undo(&game) != CHESS_ERR_NOAVAIL)
+				n_played--;
+		}
+		if (i >= MAX_PLIES || !apply(m)) {
+			say("info string illegal move %s", m);
+			return;
+		}
+		snprintf(played[n_played++], sizeof played[0], "%s", m);
+	}
+	if (i < n_played) {
+		// the GUI took moves back
+		while (n_played > i && chess_undo(&game) != CHESS_ERR_NOAVAIL)
+			n_played--;
+	}
+}
+
+static const int piece_value[CHESS_NUM_PIECES] = { [PAWN] = 100, [KNIGHT] = 300, [BISHOP] = 300, [ROOK] = 500, [QUEEN] = 900 };
+
+// what the search in progress may spend
+static struct {
+	unsigned int go;
+	long deadline;
+	unsigned long nodes, max_nodes;
+	bool out;
+} limits;
+
+static bool out_of_time(void) {
+	if (limits.out)
+		return true;
+	if (++limits.nodes % CLOCK_NODES == 0 || limits.nodes >= limits.max_nodes)
+		limits.out = atomic_load(&stops) >= limits.go || limits.nodes >= limits.max_nodes ||
+				(limits.deadline >= 0 && now_ms() >= limits.deadline);
+	return limits.out;
+}
+
+// material from the side to move's point of view
+static int material(void) {
+	int score = 0;
+	for (int p = PAWN; p < KING; ++p)
+		score += piece_value[p] * (__builtin_popcountll(game.pieces[game.turn][p]) -
+				__builtin_popcountll(game.pieces[swith(game.turn)][p]));
+	return score;
+}
+
+// plays m, scoring what it ends the game with, or returns false to search on
+static bool play_scored(const chess_move *m, int ply, int *score) {
+	chess_return r = chess_move_coord(&game, m->x, m->y, m->tx, m->ty, m->promote);
+	*score = (CHESS_MATE == r) ? MATE_SCORE - ply - 1 : 0;
+	return CHESS_MATE == r || CHESS_STALE == r;
+}
+
+// only captures and promotions, until the side to move would rather stand
+static int quiesce(int ply, int alpha, int beta) {
+	int score = material();
+	if (score >= beta || ply >= MAX_DEPTH * 2)
+		return score;
+	if (score > alpha)
+		alpha = score;
+	chess_gen gen;
+	chess_move m;
+	chess_gen_init(&gen, &game);
+	// stop before the quiet moves are generated, not after
+	while (gen.next < gen.n && chess_gen_next(&gen, &m) && CHESS_GEN_TACTICAL == gen.stage) {
+		if (out_of_time())
+			return 0;
+		if (!play_scored(&m, ply, &score))
+			score = -quiesce(ply + 1, -beta, -alpha);
+		chess_undo(&game);
+		if (score >= beta)
+			return score;
+		if (score > alpha)
+			alpha = score;
+	}
+	return alpha;
+}
+
+static int search(int depth, int ply, int alpha, int beta) {
+	// drawn by the fifty-move rule
+	if (game.halfmoves >= 100)
+		return 0;
+	if (0 == depth)
+		return quiesce(ply, alpha, beta);
+	chess_gen gen;
+	chess_move m;
+	chess_gen_init(&gen, &game);
+	while (chess_gen_next(&gen, &m)) {
+		if (out_of_time())
+			return 0;
+		int score;
+		if (!play_scored(&m, ply, &score))
+			score = -search(depth - 1, ply + 1, -beta, -alpha);
+		chess_undo(&game);
+		if (score >= beta)
+			return score;
+		if (score > alpha)
+			alpha = score;
+	}
+	return alpha;
+}
+
+/*
+ * go [wtime N] [btime N] [winc N] [binc N] [movetime N] [depth N] [nodes N] [infinite]
+ * searches deeper one ply at a time, alpha-beta on material with captures
+ * played out, until the limits given or the clock run out or a stop comes
+ */
+static void go(char *args) {
+	long wtime = -1, btime = -1, winc = 0, binc = 0, movetime = -1, depth = MAX_DEPTH, nodes = -1;
+	bool infinite = false;
+	char *save = NULL;
+	for (char *tok = strtok_r(args, " ", &save); tok; tok = strtok_r(NULL, " ", &save)) {
+		char *val = NULL;
+		if (strcmp(tok, "infinite") == 0)
+			infinite = true;
+		else if (NULL != (val = strtok_r(NULL, " ", &save))) {
+			if (strcmp(tok, "wtime") == 0)
+				wtime = atol(val);
+			else if (strcmp(tok, "btime") == 0)
+				btime = atol(val);
+			else if (strcmp(tok, "winc") == 0)
+				winc = atol(val);
+			else if (strcmp(tok, "binc") == 0)
+				binc = atol(val);
+			else if (strcmp(tok, "movetime") == 0)
+				movetime = atol(val);
+			else if (strcmp(tok, "depth") == 0)
+				depth = atol(val);
+			else if (strcmp(tok, "nodes") == 0)
+				nodes = atol(val);
+		}
+	}
+	long left = (WHITE == game.turn) ? wtime : btime;
+	long inc = (WHITE == game.turn) ? winc : binc;
+	long budget = (movetime >= 0) ? movetime : (left >= 0) ? left / MOVES_TO_GO + inc : -1;
+	if (depth < 1 || depth > MAX_DEPTH)
+		depth = MAX_DEPTH;
+	limits.deadline = (budget >= 0 && !infinite) ? now_ms() + budget : -1;
+	limits.max_nodes = (nodes > 0) ? (unsigned long) nodes : ULONG_MAX;
+	limits.nodes = 0;
+	limits.out = false;
+
+	chess_move moves[CHESS_MAX_MOVES];
+	size_t n = chess_legal_moves(&game, moves);
+	for (int d = 1; d <= depth && n > 0; ++d) {
+		// the best move so far goes first, so a search cut short still has it
+		int alpha = -MATE_SCORE - 1, pick = -1;
+		for (size_t i = 0; i < n && !out_of_time(); ++i) {
+			int score;
+			if (!play_scored(&moves[i], 0, &score))
+				score = -search(d - 1, 1, -MATE_SCORE - 1, -alpha);
+			chess_undo(&game);
+			if (limits.out)
+				break;
+			if (score > alpha) {
+				alpha = score;
+				pick = i;
+			}
+		}
+		if (pick < 0)
+			break;
+		chess_move tmp = moves[pick];
+		memmove(&moves[1], &moves[0], pick * sizeof *moves);
+		moves[0] = tmp;
+		char buf[6];
+		write_move(&moves[0], buf);
+		if (alpha > MATE_SCORE - MAX_DEPTH * 2)
+			say("info depth %d score mate %d nodes %lu pv %s", d, (MATE_SCORE - alpha + 1) / 2, limits.nodes, buf);
+		else if (alpha < MAX_DEPTH * 2 - MATE_SCORE)
+			say("info depth %d score mate %d nodes %lu pv %s", d, -(MATE_SCORE + alpha + 1) / 2, limits.nodes, buf);
+		else
+			say("info depth %d score cp %d nodes %lu pv %s", d, alpha, limits.nodes, buf);
+		if (limits.out || alpha > MATE_SCORE - MAX_DEPTH * 2)
+			break;
+	}
+	// an infinite search only reports back once told to stop
+	while (infinite && atomic_load(&stops) < limits.go) {
+		struct timespec nap = { 0, 1000000 };
+		nanosleep(&nap, NULL);
+	}
+	if (n == 0) {
+		say("bestmove 0000");
+		return;
+	}
+	// even with no time to finish one ply, any legal move beats none
+	char buf[6];
+	write_move(&moves[0], buf);
+	say("bestmove %s", buf);
+}
+
+// "go" on its own or with arguments, not a longer word starting with it
+static bool is_go(const char *line) {
+	return strncmp(line, "go", 2) == 0 && ('\0' == line[2] || ' ' == line[2]);
+}
+
+static void *worker(void *arg) {
+	(void) arg;
+	unsigned int started = 0;
+	while (1) {
+		char *line = pop();
+		if (strcmp(line, "quit") == 0) {
+			free(line);
+			return NULL;
+		}
+		if (strncmp(line, "position ", 9) == 0)
+			position(line + 9);
+		else if (is_go(line)) {
+			// the gos are taken in the order they were counted
+			limits.go = ++started;
+			go(line + 2);
+		}
+		else if (strcmp(line, "ucinewgame") == 0)
+			new_game("startpos");
+		free(line);
+	}
+}
+
+int main(void) {
+	char *line = malloc(LINE_LEN);
+	pthread_t thread;
+
+	reset(&game);
+	strcpy(base, "startpos");
+	pthread_create(&thread, NULL, worker, NULL);
+
+	while (NULL != fgets(line, LINE_LEN, stdin)) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if (strcmp(line, "uci") == 0) {
+			say("id name chess");
+			say("id author jaydenferrin");
+			say("uciok");
+		} else if (strcmp(line, "isready") == 0) {
+			// the worker takes commands in order, so anything sent before is already queued
+			say("readyok");
+		} else if (strcmp(line, "stop") == 0) {
+			atomic_store(&stops, atomic_load(&gos));
+		} else if (strcmp(line, "quit") == 0) {
+			break;
+		} else if (is_go(line)) {
+			atomic_fetch_add(&gos, 1);
+			push(line);
+		} else if (strncmp(line, "position ", 9) == 0 || strcmp(line, "ucinewgame") == 0) {
+			push(line);
+		}
+	}
+
+	atomic_store(&stops, UINT_MAX);
+	push("quit");
+	pthread_join(thread, NULL);
+	cleanup(&game);
+	free(line);
+	return 0;
+}
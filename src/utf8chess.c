@@ -1,4 +1,6 @@
 #include "chess.h"
+#include "book.h"
+#include "writer.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <signal.h>
@@ -6,10 +8,12 @@
 #include <stdbool.h>
 
 #define BUF_LEN 64
+#define BOOK_MAX 8
 
 void print_board(board, bool);
 char ***parse_args(int argc, char *argv[]);
 void free_triple(char ***ptr, size_t size);
+size_t book_suggest(chess_book *book, chess_t *game, char *best);
 
 struct termios *orig_info = NULL;
 
@@ -17,6 +21,17 @@ int main(int argc, char *argv[]) {
 	chess_t game;
 	char buf[BUF_LEN];
 	chess_return state = 0;
+	chess_book book = { 0 };
+
+	if (argc > 2 && strcmp(argv[1], "--book") == 0) {
+		if (chess_book_open(&book, argv[2]) < 0) {
+			fprintf(stderr, "unable to open book %s\n", argv[2]);
+			return 1;
+		}
+		// the rest of the arguments are read as if the flag wasn't there
+		argv += 2;
+		argc -= 2;
+	}
 
 	reset(&game);
 
@@ -52,15 +67,26 @@ int main(int argc, char *argv[]) {
 		printf(         "                                                                                "
 				"\033[80D\r"
 				//"                                \033[32D\033[1A\r"
-				"%s's move: ", 
+				"%s's move",
 				print_color(game.turn));
+		char best[8] = "";
+		book_suggest(&book, &game, best);
+		printf(": ");
 		if (NULL == fgets(buf, BUF_LEN, stdin))
 			break;
+		// an empty move plays the book's favourite
+		if ('\n' == *buf && *best)
+			strcpy(buf, best);
 		strtok(buf, "\n");
 		// buf has the move the player wants to make
 		printf("                                                                                "
 				"\033[80D\r");
-		state = move(&game, buf);
+		// undo and redo step through the game instead of making a move
+		bool back = strcmp(buf, "undo") == 0, forward = strcmp(buf, "redo") == 0;
+		if (back || forward)
+			state = back ? chess_undo(&game) : chess_redo(&game);
+		else
+			state = move(&game, buf);
 		switch (state) {
 			case CHESS_ERR:
 				printf("unknown error occurred.\n");
@@ -72,7 +98,10 @@ int main(int argc, char *argv[]) {
 				printf("%s is an illegal move\n", buf);
 				break;
 			case CHESS_ERR_NOAVAIL:
-				printf("No piece is able to achieve %s\n", buf);
+				if (back || forward)
+					printf("There is no move to %s\n", buf);
+				else
+					printf("No piece is able to achieve %s\n", buf);
 				break;
 			case CHESS_ERR_AMBIG:
 				printf("%s is too ambiguous\n", buf);
@@ -100,13 +129,43 @@ int main(int argc, char *argv[]) {
 	}
 
 	printf("\n");
-	printf("%s\n", game.history);
+	// the game goes out as PGN, past anything still buffered in stdout
+	fflush(stdout);
+	chess_writer pgn;
+	if (chess_writer_init(&pgn, fileno(stdout), CHESS_PGN, 0) == 0) {
+		chess_write_game(&pgn, &game, NULL);
+		chess_writer_free(&pgn);
+	}
 
 	cleanup (&game);
+	chess_book_close(&book);
 
 	return 0;
 }
 
+/*
+ * prints the book's moves for this position after the prompt and leaves
+ * the heaviest one in best, returns how many there were
+ */
+size_t book_suggest(chess_book *book, chess_t *game, char *best) {
+	chess_book_move moves[BOOK_MAX];
+	size_t n = chess_book_probe(book, game, moves, BOOK_MAX);
+	if (0 == n)
+		return 0;
+	size_t top = 0;
+	printf(" (book:");
+	for (size_t i = 0; i < n; ++i) {
+		char san[8];
+		chess_book_san(game, &moves[i], san);
+		printf(" %s", san);
+		if (moves[i].weight > moves[top].weight)
+			top = i;
+	}
+	printf(")");
+	chess_book_san(game, &moves[top], best);
+	return n;
+}
+
 void free_triple(char ***ptr, size_t size) {
 	for (int i = 0; i < size; ++i) {
 		free(ptr[i]);
@@ -0,0 +1,237 @@
+#include "writer.h"
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// PGN movetext lines stay under 80 characters
+#define PGN_LINE 79
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+/*
+ * sets up a writer to fd with a buffer of cap bytes, CHESS_WRITER_BUF if
+ * cap is 0. returns 0 on success, -1 if the buffer can't be allocated
+ */
+int chess_writer_init(chess_writer *w, int fd, chess_format format, size_t cap) {
+	w->fd = fd;
+	w->format = format;
+	w->len = 0;
+	w->cap = cap ? cap : CHESS_WRITER_BUF;
+	w->buf = malloc(w->cap);
+	return (NULL == w->buf) ? -1 : 0;
+}
+
+static int write_all(int fd, const char *p, size_t n) {
+	while (n > 0) {
+		ssize_t done = write(fd, p, n);
+		if (done < 0) {
+			if (EINTR == errno)
+				continue;
+			return -1;
+		}
+		p += done;
+		n -= done;
+	}
+	return 0;
+}
+
+// returns 0 on success, -1 if the write failed, in which case what was buffered is lost
+int chess_writer_flush(chess_writer *w) {
+	int ret = write_all(w->fd, w->buf, w->len);
+	w->len = 0;
+	return ret;
+}
+
+static int put(chess_writer *w, const char *s, size_t n) {
+	if (n > w->cap - w->len && chess_writer_flush(w) < 0)
+		return -1;
+	// too big to buffer at all, it goes straight out
+	if (n > w->cap)
+		return write_all(w->fd, s, n);
+	memcpy(w->buf + w->len, s, n);
+	w->len += n;
+	return 0;
+}
+
+static int put_str(chess_writer *w, const char *s) {
+	return put(w, s, strlen(s));
+}
+
+// writes s to go between quotes, escaping what PGN or JSON can't hold as is
+static int put_escaped(chess_writer *w, const char *s) {
+	int err = 0;
+	const char *run = s;
+	for (; *s; ++s) {
+		unsigned char c = *s;
+		if ('"' != c && '\\' != c && c >= 0x20)
+			continue;
+		err |= put(w, run, s - run);
+		run = s + 1;
+		if (c >= 0x20) {
+			err |= put(w, "\\", 1);
+			err |= put(w, s, 1);
+		} else if (CHESS_NDJSON == w->format) {
+			char esc[8];
+			err |= put(w, esc, snprintf(esc, sizeof esc, "\\u%04x", c));
+		} else {
+			// PGN has no way to escape control characters
+			err |= put(w, " ", 1);
+		}
+	}
+	return err | put(w, run, s - run);
+}
+
+// the result and how the game ended, from the tags if given, else from the position
+static void outcome(chess_t *chess, const chess_tags *tags, const char **result, const char **termination) {
+	chess_gen gen;
+	chess_move m;
+	chess_gen_init(&gen, chess);
+	if (chess_gen_next(&gen, &m)) {
+		*result = "*";
+		*termination = "unterminated";
+	} else if (NOCOLOR != chess->check) {
+		*result = (WHITE == chess->turn) ? "0-1" : "1-0";
+		*termination = "checkmate";
+	} else {
+		*result = "1/2-1/2";
+		*termination = "stalemate";
+	}
+	if (NULL != tags && NULL != tags->result)
+		*result = tags->result;
+	if (NULL != tags && NULL != tags->termination)
+		*termination = tags->termination;
+}
+
+// the next move in the history after at, skipping move numbers. returns its length, 0 at the end
+static size_t next_move(const char **at) {
+	while (1) {
+		const char *s = *at;
+		while (' ' == *s)
+			s++;
+		size_t len = strcspn(s, " ");
+		*at = s + len;
+		if (0 == len || '.' != s[len - 1])
+			return len;
+	}
+}
+
+static int write_pgn(chess_writer *w, chess_t *chess, const char *tags[6], const char *result,
+		const char *termination, const char *start) {
+	static const char *names[6] = { "Event", "Site", "Date", "Round", "White", "Black" };
+	int err = 0;
+	for (int i = 0; i < 6; ++i) {
+		err |= put_str(w, "[");
+		err |= put_str(w, names[i]);
+		err |= put_str(w, " \"");
+		err |= put_escaped(w, tags[i]);
+		err |= put_str(w, "\"]\n");
+	}
+	err |= put_str(w, "[Result \"");
+	err |= put_escaped(w, result);
+	err |= put_str(w, "\"]\n");
+	if (NULL != start) {
+		err |= put_str(w, "[SetUp \"1\"]\n[FEN \"");
+		err |= put_str(w, start);
+		err |= put_str(w, "\"]\n");
+	}
+	err |= put_str(w, "[Termination \"");
+	err |= put_escaped(w, termination);
+	err |= put_str(w, "\"]\n\n");
+
+	// the history is already in PGN movetext, it only needs wrapping
+	const char *s = chess_history(chess);
+	size_t col = 0;
+	while (*s) {
+		while (' ' == *s)
+			s++;
+		size_t len = strcspn(s, " ");
+		if (0 == len)
+			break;
+		if (col > 0) {
+			err |= put(w, (col + 1 + len > PGN_LINE) ? "\n" : " ", 1);
+			col = (col + 1 + len > PGN_LINE) ? 0 : col + 1;
+		}
+		err |= put(w, s, len);
+		col += len;
+		s += len;
+	}
+	if (col > 0)
+		err |= put(w, (col + 1 + strlen(result) > PGN_LINE) ? "\n" : " ", 1);
+	err |= put_str(w, result);
+	return err | put_str(w, "\n\n");
+}
+
+static int write_ndjson(chess_writer *w, chess_t *chess, const char *tags[6], const char *result,
+		const char *termination, const char *start) {
+	static const char *names[6] = { "event", "site", "date", "round", "white", "black" };
+	int err = 0;
+	for (int i = 0; i < 6; ++i) {
+		err |= put_str(w, i ? ",\"" : "{\"");
+		err |= put_str(w, names[i]);
+		err |= put_str(w, "\":\"");
+		err |= put_escaped(w, tags[i]);
+		err |= put_str(w, "\"");
+	}
+	err |= put_str(w, ",\"result\":\"");
+	err |= put_escaped(w, result);
+	err |= put_str(w, "\",\"termination\":\"");
+	err |= put_escaped(w, termination);
+	err |= put_str(w, "\"");
+	if (NULL != start) {
+		err |= put_str(w, ",\"start\":\"");
+		err |= put_str(w, start);
+		err |= put_str(w, "\"");
+	}
+	err |= put_str(w, ",\"moves\":[");
+	const char *s = chess_history(chess);
+	for (size_t len, n = 0; (len = next_move(&s)) > 0; ++n) {
+		err |= put_str(w, n ? ",\"" : "\"");
+		err |= put(w, s - len, len);
+		err |= put_str(w, "\"");
+	}
+	char fen[CHESS_FEN_MAX];
+	chess_fen(chess, fen);
+	err |= put_str(w, "],\"fen\":\"");
+	err |= put_str(w, fen);
+	return err | put_str(w, "\"}\n");
+}
+
+/*
+ * adds a finished game to the writer's buffer, writing the buffer out
+ * first if it is full. tags may be NULL. returns 0 on success, or -1 if
+ * writing failed
+ */
+int chess_write_game(chess_writer *w, chess_t *chess, const chess_tags *tags) {
+	const char *given[6] = { NULL };
+	if (NULL != tags) {
+		given[0] = tags->event;
+		given[1] = tags->site;
+		given[2] = tags->date;
+		given[3] = tags->round;
+		given[4] = tags->white;
+		given[5] = tags->black;
+	}
+	for (int i = 0; i < 6; ++i)
+		if (NULL == given[i])
+			given[i] = "?";
+	const char *result, *termination;
+	outcome(chess, tags, &result, &termination);
+	// games from the usual starting position don't need to say where they started
+	char start[CHESS_FEN_MAX];
+	chess_start_fen(chess, start);
+	bool setup = strcmp(start, START_FEN) != 0;
+	if (CHESS_PGN == w->format)
+		return write_pgn(w, chess, given, result, termination, setup ? start : NULL);
+	return write_ndjson(w, chess, given, result, termination, setup ? start : NULL);
+}
+
+// flushes what is left and frees the buffer, the file descriptor stays open
+int chess_writer_free(chess_writer *w) {
+	int ret = chess_writer_flush(w);
+	free(w->buf);
+	w->buf = NULL;
+	w->cap = 0;
+	return ret;
+}
@@ -0,0 +1,135 @@
+/*
+ * probes the endgame bitbase make bitbases writes: a few positions whose
+ * result is known, material it doesn't cover, and random positions of
+ * every table, where the result has to follow from those a move away
+ */
+#include "bitbase.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RANDOM_POSITIONS 20000
+
+static const struct {
+	const char *fen;
+	chess_wdl wdl;
+} known[] = {
+	{ "4k3/8/8/8/8/8/8/3QK3 w - - 0 1", CHESS_WDL_WIN },
+	{ "4k3/8/8/8/8/8/8/3QK3 b - - 0 1", CHESS_WDL_LOSS },
+	{ "4k3/8/8/8/8/8/8/R3K3 b - - 0 1", CHESS_WDL_LOSS },
+	// black has the queen, so it is black that wins
+	{ "3qk3/8/8/8/8/8/8/4K3 w - - 0 1", CHESS_WDL_LOSS },
+	// stalemate
+	{ "k7/2Q5/1K6/8/8/8/8/8 b - - 0 1", CHESS_WDL_DRAW },
+	// the king in front of its pawn on the sixth wins whoever moves
+	{ "4k3/8/4K3/4P3/8/8/8/8 w - - 0 1", CHESS_WDL_WIN },
+	{ "4k3/8/4K3/4P3/8/8/8/8 b - - 0 1", CHESS_WDL_LOSS },
+	// the rook pawn with the king in the corner ahead of it doesn't
+	{ "k7/8/8/8/8/8/P7/K7 w - - 0 1", CHESS_WDL_DRAW },
+	{ "8/8/8/8/8/8/8/k6K w - - 0 1", CHESS_WDL_DRAW },
+	{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", CHESS_WDL_NONE },
+	{ "4k3/8/8/8/8/8/8/2B1K3 w - - 0 1", CHESS_WDL_NONE },
+	{ "r3k3/8/8/8/8/8/8/R3K3 w - - 0 1", CHESS_WDL_NONE },
+	{ "4k3/8/8/8/8/8/8/RR2K3 w - - 0 1", CHESS_WDL_NONE },
+};
+
+// what the side to move gets, with what the bitbase doesn't cover a draw
+static chess_wdl probe(const chess_bitbase *bb, const chess_t *chess) {
+	chess_wdl wdl = chess_bitbase_probe(bb, chess);
+	return (CHESS_WDL_NONE == wdl) ? CHESS_WDL_DRAW : wdl;
+}
+
+// the best the side to move gets out of the results a move away
+static chess_wdl searched(const chess_bitbase *bb, chess_t *chess) {
+	chess_move moves[CHESS_MAX_MOVES];
+	size_t n = chess_legal_moves(chess, moves);
+	if (0 == n)
+		return (NOCOLOR != chess->check) ? CHESS_WDL_LOSS : CHESS_WDL_DRAW;
+	chess_wdl best = CHESS_WDL_LOSS;
+	for (size_t i = 0; i < n && CHESS_WDL_WIN != best; ++i) {
+		const chess_move *m = &moves[i];
+		chess_move_coord(chess, m->x, m->y, m->tx, m->ty, m->promote);
+		chess_wdl wdl = -probe(bb, chess);
+		chess_undo(chess);
+		if (wdl > best)
+			best = wdl;
+	}
+	return best;
+}
+
+// a FEN with the kings and one piece of strong's on the squares given, or false if two share one
+static bool place(char *fen, const int sq[3], char piece, color strong, color turn) {
+	char b[BOARD_HEIGHT][BOARD_LENGTH];
+	memset(b, 0, sizeof b);
+	const char pieces[3] = { 'K', 'k', piece };
+	for (int i = 0; i < 3; ++i) {
+		char *at = &b[sq[i] / BOARD_LENGTH][sq[i] % BOARD_LENGTH];
+		if (*at)
+			return false;
+		*at = (2 == i && BLACK == strong) ? piece + 'a' - 'A' : pieces[i];
+	}
+	for (int y = 0; y < BOARD_HEIGHT; ++y) {
+		int empty = 0;
+		for (int x = 0; x < BOARD_LENGTH; ++x) {
+			if (b[y][x]) {
+				if (empty)
+					*fen++ = '0' + empty;
+				empty = 0;
+				*fen++ = b[y][x];
+			} else
+				empty++;
+		}
+		if (empty)
+			*fen++ = '0' + empty;
+		*fen++ = (y < BOARD_HEIGHT - 1) ? '/' : ' ';
+	}
+	sprintf(fen, "%c - - 0 1", (WHITE == turn) ? 'w' : 'b');
+	return true;
+}
+
+int main(int argc, char *argv[]) {
+	const char *path = (argc > 1) ? argv[1] : "endgame.bb";
+	chess_bitbase bb;
+	if (chess_bitbase_open(&bb, path) < 0) {
+		printf("bitbase_test: can't open %s, make bitbases writes it\n", path);
+		return 1;
+	}
+	chess_t game;
+	reset(&game);
+	int failed = 0;
+	for (size_t i = 0; i < sizeof known / sizeof *known && !failed; ++i) {
+		chess_wdl wdl = CHESS_WDL_NONE - 1;
+		if (chess_load_fen(&game, known[i].fen) < 0 || (wdl = chess_bitbase_probe(&bb, &game)) != known[i].wdl) {
+			printf("bitbase_test: %s probes as %d, not %d\n", known[i].fen, wdl, known[i].wdl);
+			failed = 1;
+		}
+	}
+
+	srand(1);
+	const char pieces[] = { 'P', 'R', 'Q' };
+	unsigned long probed = 0, won = 0;
+	char fen[CHESS_FEN_MAX];
+	while (probed < RANDOM_POSITIONS && !failed) {
+		int sq[3] = { rand() % 64, rand() % 64, rand() % 64 };
+		char piece = pieces[probed % 3];
+		color strong = rand() % 2, turn = rand() % 2;
+		// pawns never stand on the first or last rank
+		if ('P' == piece && (sq[2] < BOARD_LENGTH || sq[2] >= (BOARD_HEIGHT - 1) * BOARD_LENGTH))
+			continue;
+		if (!place(fen, sq, piece, strong, turn) || chess_load_fen(&game, fen) < 0)
+			continue;
+		chess_wdl wdl = chess_bitbase_probe(&bb, &game), want = searched(&bb, &game);
+		if (wdl != want) {
+			printf("bitbase_test: %s probes as %d, a move on gives %d\n", fen, wdl, want);
+			failed = 1;
+		}
+		won += CHESS_WDL_DRAW != wdl;
+		probed++;
+	}
+	cleanup(&game);
+	chess_bitbase_close(&bb);
+	if (!failed)
+		printf("bitbase_test: %zu known positions, %lu random ones of which %lu won or lost\n",
+				sizeof known / sizeof *known, probed, won);
+	return failed;
+}
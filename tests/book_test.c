@@ -0,0 +1,108 @@
+/*
+ * writes a book out of random games and reads it back: every move played
+ * has to be found with its weight, and play again to the same position
+ */
+#include "book.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define GAMES 400
+#define PLIES 40
+
+typedef struct {
+	unsigned char e[CHESS_BOOK_ENTRY];
+	chess_t before;
+	uint64_t after;
+} noted;
+
+static noted notes[GAMES * PLIES];
+static size_t n_notes;
+
+static int by_entry(const void *a, const void *b) {
+	return memcmp(((const noted *) a)->e, ((const noted *) b)->e, 10);
+}
+
+int main(void) {
+	srand(1);
+	chess_t games[GAMES];
+	unsigned long castles = 0;
+	for (int g = 0; g < GAMES; ++g) {
+		reset(&games[g]);
+		for (int p = 0; p < PLIES; ++p) {
+			chess_t *chess = &games[g];
+			chess_move moves[CHESS_MAX_MOVES];
+			size_t n = chess_legal_moves(chess, moves);
+			if (0 == n)
+				break;
+			// castle whenever it can, so there are plenty of them
+			const chess_move *m = &moves[rand() % n];
+			for (size_t i = 0; i < n; ++i)
+				if (KING == chess->b[moves[i].y][moves[i].x].pi && abs(moves[i].tx - moves[i].x) == 2)
+					m = &moves[i];
+			noted *note = &notes[n_notes++];
+			note->before = *chess;
+			castles += KING == chess->b[m->y][m->x].pi && abs(m->tx - m->x) == 2;
+			// the weight says where the note came from
+			chess_book_entry(chess->hash, chess_book_pack(chess, m), n_notes, note->e);
+			chess_move_coord(chess, m->x, m->y, m->tx, m->ty, m->promote);
+			note->after = chess->hash;
+		}
+	}
+	// a position and move played twice only goes in once, the book would add them up
+	qsort(notes, n_notes, sizeof *notes, by_entry);
+	char path[] = "/tmp/book_testXXXXXX";
+	int fd = mkstemp(path);
+	FILE *f = fdopen(fd, "wb");
+	size_t written = 0;
+	for (size_t i = 0; i < n_notes; ++i) {
+		if (i > 0 && 0 == by_entry(&notes[i - 1], &notes[i]))
+			continue;
+		fwrite(notes[i].e, CHESS_BOOK_ENTRY, 1, f);
+		notes[written++] = notes[i];
+	}
+	fclose(f);
+
+	chess_book book;
+	chess_t replay;
+	reset(&replay);
+	int failed = 0;
+	if (chess_book_open(&book, path) < 0 || book.entries != written) {
+		printf("book_test: can't read the book back\n");
+		failed = 1;
+	}
+	for (size_t i = 0; i < written && !failed; ++i) {
+		chess_book_move found[64];
+		size_t n = chess_book_probe(&book, &notes[i].before, found, 64);
+		unsigned int weight = notes[i].e[10] << 8 | notes[i].e[11];
+		size_t j = 0;
+		while (j < n && found[j].weight != weight)
+			j++;
+		if (j == n) {
+			printf("book_test: entry %zu not found\n", i);
+			failed = 1;
+			break;
+		}
+		char fen[CHESS_FEN_MAX], san[8];
+		chess_fen(&notes[i].before, fen);
+		chess_load_fen(&replay, fen);
+		chess_book_san(&replay, &found[j], san);
+		if (move(&replay, san) < 0 || replay.hash != notes[i].after) {
+			printf("book_test: %s doesn't replay entry %zu\n", san, i);
+			failed = 1;
+		}
+	}
+	chess_book_close(&book);
+	unlink(path);
+	cleanup(&replay);
+	for (int g = 0; g < GAMES; ++g)
+		cleanup(&games[g]);
+	if (0 == castles) {
+		printf("book_test: no castles were played\n");
+		failed = 1;
+	}
+	if (!failed)
+		printf("book_test: %zu entries, %lu castles\n", written, castles);
+	return failed;
+}
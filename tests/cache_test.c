@@ -0,0 +1,113 @@
+/*
+ * wanders through random games, moving, taking back, redoing, seeking
+ * and loading positions, and asks the move cache for a square or all of
+ * them in between, so it is left filled in part. whatever it gives has to
+ * match the moves of the same position worked out with no cache at all
+ */
+#include "chess.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GAMES 60
+#define STEPS 600
+
+static const char *positions[] = {
+	"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+	"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+	"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+	"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+};
+
+// the targets of every square, from the moves found without the cache
+static size_t uncached(const chess_t *chess, uint64_t targets[BOARD_LENGTH * BOARD_HEIGHT], chess_move *moves) {
+	chess_t bare = *chess;
+	bare.arena = NULL;
+	size_t n = chess_legal_moves(&bare, moves);
+	memset(targets, 0, BOARD_LENGTH * BOARD_HEIGHT * sizeof *targets);
+	for (size_t i = 0; i < n; ++i)
+		targets[moves[i].y * BOARD_LENGTH + moves[i].x] |= 1ULL << (moves[i].ty * BOARD_LENGTH + moves[i].tx);
+	return n;
+}
+
+static int by_squares(const void *a, const void *b) {
+	const chess_move *x = a, *y = b;
+	if (x->y != y->y || x->x != y->x)
+		return (x->y * BOARD_LENGTH + x->x) - (y->y * BOARD_LENGTH + y->x);
+	if (x->ty != y->ty || x->tx != y->tx)
+		return (x->ty * BOARD_LENGTH + x->tx) - (y->ty * BOARD_LENGTH + y->tx);
+	return x->promote - y->promote;
+}
+
+// asks the cache for one square, or for everything, and checks it; true if it holds up
+static bool check_cache(chess_t *chess, bool all) {
+	uint64_t want[BOARD_LENGTH * BOARD_HEIGHT];
+	chess_move moves[CHESS_MAX_MOVES], got[CHESS_MAX_MOVES];
+	size_t n = uncached(chess, want, moves);
+	if (!all) {
+		int sq = rand() % (BOARD_LENGTH * BOARD_HEIGHT);
+		return chess_targets(chess, sq) == want[sq];
+	}
+	for (int sq = 0; sq < BOARD_LENGTH * BOARD_HEIGHT; ++sq)
+		if (chess_targets(chess, sq) != want[sq])
+			return false;
+	if (chess_mobility(chess) != n || chess_legal_moves(chess, got) != n)
+		return false;
+	qsort(moves, n, sizeof *moves, by_squares);
+	qsort(got, n, sizeof *got, by_squares);
+	return memcmp(moves, got, n * sizeof *got) == 0;
+}
+
+int main(void) {
+	srand(1);
+	int failed = 0;
+	unsigned long checks = 0;
+	const char *steps[] = { "move", "undo", "redo", "seek", "load" };
+	for (int g = 0; g < GAMES && !failed; ++g) {
+		chess_t game;
+		reset(&game);
+		chess_set_checkpoints(&game, 1 + g % 12);
+		unsigned int end = 0;
+		for (int s = 0; s < STEPS && !failed; ++s, ++checks) {
+			int step = rand() % 16;
+			// mostly moves, so the game gets somewhere, picked without filling the cache
+			if (step < 10) {
+				chess_move moves[CHESS_MAX_MOVES];
+				chess_t bare = game;
+				bare.arena = NULL;
+				size_t n = chess_legal_moves(&bare, moves);
+				if (0 == n) {
+					chess_undo(&game);
+				} else {
+					const chess_move *m = &moves[rand() % n];
+					chess_move_coord(&game, m->x, m->y, m->tx, m->ty, m->promote);
+					end = game.moves;
+				}
+				step = 0;
+			} else if (step < 12) {
+				chess_undo(&game);
+				step = 1;
+			} else if (step < 14) {
+				chess_redo(&game);
+				step = 2;
+			} else if (step < 15) {
+				chess_seek(&game, rand() % (end + 1));
+				step = 3;
+			} else {
+				chess_load_fen(&game, positions[rand() % (sizeof positions / sizeof *positions)]);
+				end = game.moves;
+				step = 4;
+			}
+			if (!check_cache(&game, rand() % 2)) {
+				char fen[CHESS_FEN_MAX];
+				chess_fen(&game, fen);
+				printf("cache_test: game %d is wrong after a %s at step %d, in %s\n", g, steps[step], s, fen);
+				failed = 1;
+			}
+		}
+		cleanup(&game);
+	}
+	if (!failed)
+		printf("cache_test: %lu cache checks after moves, takebacks, redos, seeks and loads\n", checks);
+	return failed;
+}
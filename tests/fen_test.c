@@ -0,0 +1,94 @@
+/*
+ * writes the FEN of every position of random games and loads it back,
+ * which must give the same position and clocks, then feeds
+ * chess_load_fen() positions that can't be, which must leave the game be
+ */
+#include "chess.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GAMES 200
+#define PLIES 200
+
+static const char *bad[] = {
+	"",
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR",
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1",
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkx - 0 1",
+	// too few ranks, too many, a rank too long, one too short
+	"rnbqkbnr/pppppppp/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"rnbqkbnr/pppppppp/8/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"rnbqkbnr/ppppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"rnbqkbnr/ppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKXNR w KQkq - 0 1",
+	// no king, two kings
+	"rnbq1bnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBKR w KQkq - 0 1",
+	// the side that just moved is in check
+	"4k3/8/8/8/8/8/8/4K2r b - - 0 1",
+	// en passant after e4 with white to move, with no pawn in front, on
+	// the wrong rank, with the square jumped from taken, off the board,
+	// then after e5 on the square white's pawn would have crossed
+	"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR w KQkq e3 0 1",
+	"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq d3 0 1",
+	"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e4 0 1",
+	"rnbqkbnr/pppppppp/8/8/4P3/8/PPPPPPPP/RNBQKBNR b KQkq e3 0 1",
+	"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq i3 0 1",
+	"rnbqkbnr/pppp1ppp/8/4p3/8/8/PPPPPPPP/RNBQKBNR w KQkq e3 0 1",
+};
+
+int main(void) {
+	srand(1);
+	chess_t game, loaded;
+	reset(&loaded);
+	int failed = 0;
+	unsigned long positions = 0;
+	char want[CHESS_FEN_MAX], got[CHESS_FEN_MAX];
+	for (int g = 0; g < GAMES && !failed; ++g) {
+		reset(&game);
+		for (int p = 0; p <= PLIES && !failed; ++p) {
+			chess_fen(&game, want);
+			if (chess_load_fen(&loaded, want) < 0) {
+				printf("fen_test: game %d's %s doesn't load\n", g, want);
+				failed = 1;
+			} else if (chess_fen(&loaded, got), strcmp(want, got) != 0 || loaded.hash != game.hash) {
+				printf("fen_test: %s loads as %s\n", want, got);
+				failed = 1;
+			}
+			positions++;
+			chess_move moves[CHESS_MAX_MOVES];
+			size_t n = chess_legal_moves(&game, moves);
+			if (0 == n)
+				break;
+			const chess_move *m = &moves[rand() % n];
+			chess_move_coord(&game, m->x, m->y, m->tx, m->ty, m->promote);
+		}
+		cleanup(&game);
+	}
+
+	// the good en passant squares, for the bad ones next to them
+	const char *jumped[] = {
+		"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1",
+		"rnbqkbnr/pppp1ppp/8/4p3/8/8/PPPPPPPP/RNBQKBNR w KQkq e6 0 2",
+	};
+	for (size_t i = 0; i < sizeof jumped / sizeof *jumped && !failed; ++i) {
+		if (chess_load_fen(&loaded, jumped[i]) < 0 || (chess_fen(&loaded, got), strcmp(got, jumped[i]) != 0)) {
+			printf("fen_test: %s doesn't load\n", jumped[i]);
+			failed = 1;
+		}
+	}
+	chess_load_fen(&loaded, "4k3/8/8/8/8/8/8/4K3 w - - 12 40");
+	chess_fen(&loaded, want);
+	for (size_t i = 0; i < sizeof bad / sizeof *bad && !failed; ++i) {
+		if (chess_load_fen(&loaded, bad[i]) != -1 || (chess_fen(&loaded, got), strcmp(got, want) != 0)) {
+			printf("fen_test: \"%s\" was taken\n", bad[i]);
+			failed = 1;
+		}
+	}
+	cleanup(&loaded);
+	if (!failed)
+		printf("fen_test: %lu positions round trip, %zu bad ones turned down\n", positions, sizeof bad / sizeof *bad);
+	return failed;
+}
@@ -0,0 +1,105 @@
+/*
+ * walks random games from the usual test positions and checks that
+ * chess_gen_next() hands out exactly the moves chess_legal_moves() finds,
+ * captures and promotions first, best first, and the quiet moves only
+ * once those run out
+ */
+#include "chess.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GAMES 40
+#define PLIES 150
+
+static const char *starts[] = {
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+	"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+	"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+	"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+};
+
+// what a piece is worth to the generator when it orders captures
+static const int worth[CHESS_NUM_PIECES] = { [PAWN] = 1, [KNIGHT] = 3, [BISHOP] = 3, [ROOK] = 5, [QUEEN] = 9 };
+
+static bool tactical(const chess_t *chess, const chess_move *m) {
+	chess_piece to = chess->b[m->ty][m->tx];
+	bool en_passant = PAWN == chess->b[m->y][m->x].pi && m->tx != m->x;
+	return (to.pi >= PAWN && to.c != chess->turn) || en_passant || BLANK != m->promote;
+}
+
+static int score(const chess_t *chess, const chess_move *m) {
+	chess_piece to = chess->b[m->ty][m->tx];
+	int victim = (to.pi >= PAWN) ? worth[to.pi] : (m->tx != m->x && PAWN == chess->b[m->y][m->x].pi);
+	return (victim + ((BLANK != m->promote) ? worth[m->promote] : 0)) * 16 - worth[chess->b[m->y][m->x].pi];
+}
+
+static int by_squares(const void *a, const void *b) {
+	const chess_move *x = a, *y = b;
+	if (x->y != y->y || x->x != y->x)
+		return (x->y * BOARD_LENGTH + x->x) - (y->y * BOARD_LENGTH + y->x);
+	if (x->ty != y->ty || x->tx != y->tx)
+		return (x->ty * BOARD_LENGTH + x->tx) - (y->ty * BOARD_LENGTH + y->tx);
+	return x->promote - y->promote;
+}
+
+// checks the generator on the position chess is in, true if it holds up
+static bool check_gen(chess_t *chess) {
+	chess_move want[CHESS_MAX_MOVES], got[CHESS_MAX_MOVES];
+	size_t n_want = chess_legal_moves(chess, want), n_got = 0;
+	chess_gen gen;
+	chess_gen_init(&gen, chess);
+	bool quiet = false;
+	int last = 0;
+	chess_move m;
+	while (chess_gen_next(&gen, &m)) {
+		if (n_got == CHESS_MAX_MOVES)
+			return false;
+		if (tactical(chess, &m)) {
+			// nothing tactical after the quiet moves start, and the best first
+			if (quiet || CHESS_GEN_TACTICAL != gen.stage || (n_got > 0 && score(chess, &m) > last))
+				return false;
+			last = score(chess, &m);
+		} else {
+			quiet = true;
+			if (CHESS_GEN_QUIET != gen.stage)
+				return false;
+		}
+		got[n_got++] = m;
+	}
+	if (n_got != n_want)
+		return false;
+	qsort(want, n_want, sizeof *want, by_squares);
+	qsort(got, n_got, sizeof *got, by_squares);
+	return memcmp(want, got, n_got * sizeof *got) == 0;
+}
+
+int main(void) {
+	srand(1);
+	int failed = 0;
+	unsigned long positions = 0;
+	char fen[CHESS_FEN_MAX];
+	for (int g = 0; g < GAMES && !failed; ++g) {
+		chess_t game;
+		reset(&game);
+		chess_load_fen(&game, starts[g % (sizeof starts / sizeof *starts)]);
+		for (int p = 0; p < PLIES && !failed; ++p, ++positions) {
+			if (!check_gen(&game)) {
+				chess_fen(&game, fen);
+				printf("gen_test: the generator gets %s wrong\n", fen);
+				failed = 1;
+			}
+			chess_move moves[CHESS_MAX_MOVES];
+			size_t n = chess_legal_moves(&game, moves);
+			if (0 == n)
+				break;
+			const chess_move *m = &moves[rand() % n];
+			chess_move_coord(&game, m->x, m->y, m->tx, m->ty, m->promote);
+		}
+		cleanup(&game);
+	}
+	if (!failed)
+		printf("gen_test: %lu positions generate alike\n", positions);
+	return failed;
+}
@@ -0,0 +1,77 @@
+/*
+ * packs every position of random games and unpacks it again, then feeds
+ * chess_unpack_position() en passant files no pawn could have jumped on
+ * and input cut short, which must all be turned down
+ */
+#include "chess.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GAMES 200
+#define PLIES 160
+
+// unpacks len bytes of in, true if it takes all of them and gives back hash and label
+static bool unpacks_to(chess_t *into, const unsigned char *in, size_t len, uint64_t hash, unsigned int label) {
+	unsigned int got = 16;
+	return chess_unpack_position(into, in, len, &got) == len && into->hash == hash && got == label;
+}
+
+int main(void) {
+	srand(1);
+	chess_t game, into;
+	reset(&into);
+	unsigned char packed[CHESS_PACKED_MAX];
+	int failed = 0;
+	unsigned long positions = 0, turned_down = 0;
+	for (int g = 0; g < GAMES && !failed; ++g) {
+		reset(&game);
+		for (int p = 0; p <= PLIES && !failed; ++p) {
+			size_t len = chess_pack_position(&game, p % 16, packed);
+			if (len > CHESS_PACKED_MAX || !unpacks_to(&into, packed, len, game.hash, p % 16)) {
+				printf("pack_test: game %d doesn't unpack at ply %d\n", g, p);
+				failed = 1;
+			}
+			// one byte short never holds a position
+			if (0 != chess_unpack_position(&into, packed, len - 1, NULL)) {
+				printf("pack_test: game %d unpacks at ply %d with a byte missing\n", g, p);
+				failed = 1;
+			}
+			positions++;
+			chess_move moves[CHESS_MAX_MOVES];
+			size_t n = chess_legal_moves(&game, moves);
+			if (0 == n)
+				break;
+			const chess_move *m = &moves[rand() % n];
+			chess_move_coord(&game, m->x, m->y, m->tx, m->ty, m->promote);
+		}
+		cleanup(&game);
+	}
+
+	// after e4 only the e file can be taken en passant, before it none can
+	reset(&game);
+	for (int jumped = 0; jumped < 2 && !failed; ++jumped) {
+		if (jumped)
+			chess_move_lan(&game, "e2e4");
+		size_t len = chess_pack_position(&game, 0, packed);
+		uint64_t hash = game.hash;
+		for (int file = -1; file < 15; ++file) {
+			packed[len - 1] = file + 1;
+			// leaving the file out is always a position, if not the one packed
+			bool ok = -1 == file || (jumped && 4 == file);
+			bool same = (-1 == file) ? !jumped : ok;
+			uint64_t before = into.hash;
+			if (ok ? chess_unpack_position(&into, packed, len, NULL) != len || (same && into.hash != hash)
+					: 0 != chess_unpack_position(&into, packed, len, NULL) || into.hash != before) {
+				printf("pack_test: en passant file %d was %s\n", file, ok ? "turned down" : "taken");
+				failed = 1;
+			}
+			turned_down += !ok;
+		}
+	}
+	cleanup(&game);
+	cleanup(&into);
+	if (!failed)
+		printf("pack_test: %lu positions round trip, %lu bad en passant files turned down\n", positions, turned_down);
+	return failed;
+}
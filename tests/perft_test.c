@@ -0,0 +1,60 @@
+/*
+ * counts the leaves of the move tree from the usual test positions, each
+ * move played and taken back, against the counts every move generator
+ * agrees on
+ */
+#include "chess.h"
+#include <stdio.h>
+
+static const struct {
+	const char *fen;
+	int depth;
+	unsigned long long nodes;
+} positions[] = {
+	{ "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 4, 197281 },
+	// castles both ways, pins, en passant and promotions all over
+	{ "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 3, 97862 },
+	// en passant that would uncover a check along the rank
+	{ "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624 },
+	{ "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 3, 9467 },
+	{ "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 3, 62379 },
+};
+
+static unsigned long long perft(chess_t *chess, int depth) {
+	chess_move moves[CHESS_MAX_MOVES];
+	size_t n = chess_legal_moves(chess, moves);
+	if (depth <= 1)
+		return n;
+	unsigned long long nodes = 0;
+	for (size_t i = 0; i < n; ++i) {
+		const chess_move *m = &moves[i];
+		chess_move_coord(chess, m->x, m->y, m->tx, m->ty, m->promote);
+		nodes += perft(chess, depth - 1);
+		chess_undo(chess);
+	}
+	return nodes;
+}
+
+int main(void) {
+	int failed = 0;
+	unsigned long long total = 0;
+	for (size_t i = 0; i < sizeof positions / sizeof *positions; ++i) {
+		chess_t game;
+		reset(&game);
+		if (chess_load_fen(&game, positions[i].fen) < 0) {
+			printf("perft_test: %s doesn't load\n", positions[i].fen);
+			return 1;
+		}
+		unsigned long long nodes = perft(&game, positions[i].depth);
+		if (nodes != positions[i].nodes) {
+			printf("perft_test: %s has %llu nodes at depth %d, not %llu\n", positions[i].fen, nodes,
+					positions[i].depth, positions[i].nodes);
+			failed = 1;
+		}
+		total += nodes;
+		cleanup(&game);
+	}
+	if (!failed)
+		printf("perft_test: %llu nodes from %zu positions\n", total, sizeof positions / sizeof *positions);
+	return failed;
+}
@@ -0,0 +1,143 @@
+/*
+ * hands out games from a pool, plays them far enough to need more arena
+ * than their slot came with, and takes them back: a game handed out again
+ * must start over like a reset() one, whichever thread gave it back
+ */
+#include "chess.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PLIES 200
+// more than a slab, so the pool has to grow
+#define HELD 150
+#define THREADS 4
+#define ROUNDS 20
+
+static char start_fen[CHESS_FEN_MAX];
+static uint64_t start_hash;
+
+/*
+ * plays the random game seed picks, the same every time, and returns the
+ * hash it ends on. sets *history to its length as chess_history() gives it
+ */
+static uint64_t play_line(chess_t *chess, unsigned int seed, size_t *history) {
+	for (int p = 0; p < PLIES; ++p) {
+		chess_move moves[CHESS_MAX_MOVES];
+		size_t n = chess_legal_moves(chess, moves);
+		if (0 == n)
+			break;
+		const chess_move *m = &moves[rand_r(&seed) % n];
+		chess_move_coord(chess, m->x, m->y, m->tx, m->ty, m->promote);
+	}
+	*history = strlen(chess_history(chess));
+	return chess->hash;
+}
+
+// true if the game is as reset() leaves one
+static bool fresh(chess_t *chess) {
+	char fen[CHESS_FEN_MAX];
+	const chess_checkpoint *checks;
+	chess_fen(chess, fen);
+	return strcmp(fen, start_fen) == 0 && chess->hash == start_hash && '\0' == *chess_history(chess)
+		&& 0 == chess_checkpoints(chess, &checks) && CHESS_ERR_NOAVAIL == chess_undo(chess)
+		&& CHESS_ERR_NOAVAIL == chess_redo(chess);
+}
+
+static chess_pool *pool;
+static uint64_t want_hash[ROUNDS];
+static size_t want_history[ROUNDS];
+// games handed from one thread to the next, to be cleaned up there
+static chess_t *passed[THREADS][ROUNDS];
+static pthread_barrier_t handed;
+static int thread_failed[THREADS];
+
+static void *worker(void *arg) {
+	int t = (int) (size_t) arg;
+	// the second time round the games come off the lists the other threads filled
+	for (int pass = 0; pass < 2; ++pass) {
+		for (int r = 0; r < ROUNDS; ++r) {
+			chess_t *game = chess_pool_get(pool);
+			size_t history;
+			if (NULL == game || !fresh(game) || play_line(game, r, &history) != want_hash[r]
+					|| history != want_history[r])
+				thread_failed[t] = 1;
+			passed[(t + 1) % THREADS][r] = game;
+		}
+		pthread_barrier_wait(&handed);
+		for (int r = 0; r < ROUNDS; ++r)
+			if (NULL != passed[t][r])
+				cleanup(passed[t][r]);
+		pthread_barrier_wait(&handed);
+	}
+	return NULL;
+}
+
+int main(void) {
+	chess_t game;
+	reset(&game);
+	chess_fen(&game, start_fen);
+	start_hash = game.hash;
+	for (int r = 0; r < ROUNDS; ++r) {
+		cleanup(&game);
+		reset(&game);
+		want_hash[r] = play_line(&game, r, &want_history[r]);
+	}
+	cleanup(&game);
+
+	int failed = 0;
+	pool = chess_pool_new();
+	chess_t *held[HELD] = { NULL };
+	for (int i = 0; i < HELD && !failed; ++i) {
+		held[i] = chess_pool_get(pool);
+		size_t history;
+		if (NULL == held[i] || !fresh(held[i])) {
+			printf("pool_test: game %d isn't handed out fresh\n", i);
+			failed = 1;
+			break;
+		}
+		for (int j = 0; j < i; ++j)
+			if (held[j] == held[i]) {
+				printf("pool_test: games %d and %d are the same\n", j, i);
+				failed = 1;
+			}
+		chess_set_checkpoints(held[i], 1 + i % 8);
+		int r = i % ROUNDS;
+		if (play_line(held[i], r, &history) != want_hash[r] || history != want_history[r]) {
+			printf("pool_test: game %d plays its line differently\n", i);
+			failed = 1;
+		}
+	}
+	// games given back are handed out again, as if never played
+	for (int i = 0; i < HELD && !failed; ++i) {
+		chess_t *was = held[i];
+		cleanup(was);
+		held[i] = chess_pool_get(pool);
+		if (held[i] != was || !fresh(held[i])) {
+			printf("pool_test: game %d comes back %s\n", i, (held[i] != was) ? "as another" : "played");
+			failed = 1;
+		}
+	}
+	for (int i = 0; i < HELD; ++i)
+		if (NULL != held[i])
+			cleanup(held[i]);
+
+	pthread_t threads[THREADS];
+	pthread_barrier_init(&handed, NULL, THREADS);
+	for (int t = 0; t < THREADS && !failed; ++t)
+		pthread_create(&threads[t], NULL, worker, (void *) (size_t) t);
+	for (int t = 0; t < THREADS && !failed; ++t)
+		pthread_join(threads[t], NULL);
+	pthread_barrier_destroy(&handed);
+	for (int t = 0; t < THREADS && !failed; ++t)
+		if (thread_failed[t]) {
+			printf("pool_test: thread %d got a game that wasn't fresh or played wrong\n", t);
+			failed = 1;
+		}
+	chess_pool_free(pool);
+	if (!failed)
+		printf("pool_test: %d games held at once, %d handed between %d threads\n", HELD, 2 * THREADS * ROUNDS,
+				THREADS);
+	return failed;
+}
@@ -0,0 +1,97 @@
+/*
+ * replays random games, some from a FEN, some with their last move
+ * spoiled or a FEN that can't be read, through chess_replay_batch() with
+ * every number of lanes, and checks each game gets back what playing it
+ * by hand gave
+ */
+#include "chess.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GAMES 300
+#define PLIES 120
+
+static chess_replay want[GAMES], got[GAMES];
+static char *histories[GAMES];
+
+int main(void) {
+	srand(1);
+	char fen[CHESS_FEN_MAX];
+	char *fens[GAMES] = { NULL };
+	uint64_t before[GAMES];
+	for (int g = 0; g < GAMES; ++g) {
+		chess_t game;
+		reset(&game);
+		// every third game starts where a few random moves got to
+		if (g % 3 == 1) {
+			for (int p = rand() % 20; p > 0; --p) {
+				chess_move moves[CHESS_MAX_MOVES];
+				size_t n = chess_legal_moves(&game, moves);
+				if (0 == n)
+					break;
+				const chess_move *m = &moves[rand() % n];
+				chess_move_coord(&game, m->x, m->y, m->tx, m->ty, m->promote);
+			}
+			chess_fen(&game, fen);
+			fens[g] = strdup(fen);
+			chess_load_fen(&game, fen);
+		}
+		want[g] = (chess_replay) { .fen = fens[g], .state = (NOCOLOR != game.check) ? CHESS_CHECK : CHESS_NORMAL,
+			.hash = game.hash };
+		for (int p = rand() % PLIES; p > 0; --p) {
+			chess_move moves[CHESS_MAX_MOVES];
+			size_t n = chess_legal_moves(&game, moves);
+			if (0 == n)
+				break;
+			const chess_move *m = &moves[rand() % n];
+			before[g] = game.hash;
+			want[g].state = chess_move_coord(&game, m->x, m->y, m->tx, m->ty, m->promote);
+			want[g].plies++;
+			want[g].hash = game.hash;
+		}
+		histories[g] = strdup(chess_history(&game));
+		want[g].history = histories[g];
+		cleanup(&game);
+	}
+	// spoil the last move of some, those stop short of it
+	for (int g = 5; g < GAMES; g += 7) {
+		size_t len = strlen(histories[g]);
+		while (len > 0 && ' ' == histories[g][len - 1])
+			len--;
+		if (want[g].plies < 1)
+			continue;
+		while (len > 0 && ' ' != histories[g][len - 1])
+			len--;
+		strcpy(histories[g] + len, "Qz9");
+		want[g].state = CHESS_ERR;
+		want[g].plies--;
+		want[g].hash = before[g];
+	}
+	fens[GAMES - 1] = "not a position";
+	want[GAMES - 1] = (chess_replay) { .fen = fens[GAMES - 1], .history = histories[GAMES - 1], .state = CHESS_ERR };
+
+	int failed = 0;
+	for (unsigned int lanes = 0; lanes <= CHESS_REPLAY_LANES + 1 && !failed; ++lanes) {
+		for (int g = 0; g < GAMES; ++g)
+			got[g] = (chess_replay) { .fen = fens[g], .history = histories[g] };
+		chess_replay_batch(got, GAMES, lanes);
+		for (int g = 0; g < GAMES && !failed; ++g) {
+			// a game that stops gets some error, which one depends on what stopped it
+			bool stopped = (want[g].state < 0) ? got[g].state < 0 : got[g].state == want[g].state;
+			if (!stopped || got[g].plies != want[g].plies || got[g].hash != want[g].hash) {
+				printf("replay_test: game %d with %u lanes stopped at ply %u (%d), not %u (%d)\n", g, lanes,
+						got[g].plies, got[g].state, want[g].plies, want[g].state);
+				failed = 1;
+			}
+		}
+	}
+	for (int g = 0; g < GAMES; ++g) {
+		free(histories[g]);
+		if (g < GAMES - 1)
+			free(fens[g]);
+	}
+	if (!failed)
+		printf("replay_test: %d games replay alike with 0 to %d lanes\n", GAMES, CHESS_REPLAY_LANES + 1);
+	return failed;
+}
@@ -0,0 +1,86 @@
+/*
+ * checks chess_see() on exchanges worked out by hand, then on every
+ * capture of random games, where it has to land between the piece taken
+ * and that less the piece taking it
+ */
+#include "chess.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define GAMES 100
+#define PLIES 150
+
+static const struct {
+	const char *fen, *from, *to;
+	int see;
+} known[] = {
+	// an undefended pawn
+	{ "1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1", "e1", "e5", 1 },
+	// a knight for a pawn, with sliders lined up behind on both sides
+	{ "1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1", "d3", "e5", -2 },
+	{ "4r1k1/8/8/4q3/3P4/8/8/4K3 w - - 0 1", "d4", "e5", 8 },
+	{ "4k3/8/3p4/4n3/8/8/8/4Q1K1 w - - 0 1", "e1", "e5", -6 },
+	// the rook behind makes the trade even
+	{ "4k3/4r3/8/8/8/4p3/4R3/6K1 w - - 0 1", "e2", "e3", -4 },
+	{ "4k3/4r3/8/8/8/4p3/4R3/4R1K1 w - - 0 1", "e2", "e3", 1 },
+	{ "4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", "e5", "d6", 1 },
+	{ "4k3/8/8/8/8/8/8/4K3 w - - 0 1", "d4", "e5", 0 },
+};
+
+static const int worth[CHESS_NUM_PIECES] = { [PAWN] = 1, [KNIGHT] = 3, [BISHOP] = 3, [ROOK] = 5, [QUEEN] = 9 };
+
+static int square(const char *s) {
+	return (BOARD_HEIGHT - (s[1] - '0')) * BOARD_LENGTH + (s[0] - 'a');
+}
+
+int main(void) {
+	srand(1);
+	chess_t game;
+	reset(&game);
+	int failed = 0;
+	for (size_t i = 0; i < sizeof known / sizeof *known && !failed; ++i) {
+		chess_load_fen(&game, known[i].fen);
+		int see = chess_see(&game, square(known[i].from), square(known[i].to));
+		if (see != known[i].see) {
+			printf("see_test: %s%s in %s comes to %d, not %d\n", known[i].from, known[i].to, known[i].fen, see,
+					known[i].see);
+			failed = 1;
+		}
+	}
+	cleanup(&game);
+
+	unsigned long captures = 0;
+	for (int g = 0; g < GAMES && !failed; ++g) {
+		reset(&game);
+		for (int p = 0; p < PLIES && !failed; ++p) {
+			chess_move moves[CHESS_MAX_MOVES];
+			size_t n = chess_legal_moves(&game, moves);
+			if (0 == n)
+				break;
+			for (size_t i = 0; i < n && !failed; ++i) {
+				const chess_move *m = &moves[i];
+				chess_piece mover = game.b[m->y][m->x], victim = game.b[m->ty][m->tx];
+				bool en_passant = PAWN == mover.pi && m->tx != m->x && victim.pi < PAWN;
+				if (victim.pi < PAWN && !en_passant)
+					continue;
+				int taken = en_passant ? worth[PAWN] : worth[victim.pi];
+				int see = chess_see(&game, m->y * BOARD_LENGTH + m->x, m->ty * BOARD_LENGTH + m->tx);
+				// the other side only takes back if it pays, and never more than the piece that took
+				if (see > taken || see < taken - worth[mover.pi]) {
+					char fen[CHESS_FEN_MAX];
+					chess_fen(&game, fen);
+					printf("see_test: %c%d%c%d in %s comes to %d\n", 'a' + m->x, BOARD_HEIGHT - m->y, 'a' + m->tx,
+							BOARD_HEIGHT - m->ty, fen, see);
+					failed = 1;
+				}
+				captures++;
+			}
+			const chess_move *m = &moves[rand() % n];
+			chess_move_coord(&game, m->x, m->y, m->tx, m->ty, m->promote);
+		}
+		cleanup(&game);
+	}
+	if (!failed)
+		printf("see_test: %zu exchanges by hand, %lu captures in range\n", sizeof known / sizeof *known, captures);
+	return failed;
+}
@@ -0,0 +1,78 @@
+/*
+ * plays random games with checkpoints, taking moves back and playing
+ * others over them, and seeks to every ply: in the game, and from its
+ * history and checkpoints alone. each has to give the position the game
+ * was in then, halfmove clock included
+ */
+#include "chess.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GAMES 60
+#define PLIES 150
+
+static char fens[PLIES + 1][CHESS_FEN_MAX];
+
+// plays random moves from the ply the game is at, noting each position
+static unsigned int play_on(chess_t *chess, unsigned int ply) {
+	for (; ply < PLIES; ++ply) {
+		chess_move moves[CHESS_MAX_MOVES];
+		size_t n = chess_legal_moves(chess, moves);
+		if (0 == n)
+			break;
+		const chess_move *m = &moves[rand() % n];
+		chess_move_coord(chess, m->x, m->y, m->tx, m->ty, m->promote);
+		chess_fen(chess, fens[ply + 1]);
+	}
+	return ply;
+}
+
+int main(void) {
+	srand(1);
+	int failed = 0;
+	unsigned long seeks = 0;
+	for (int g = 0; g < GAMES && !failed; ++g) {
+		chess_t game;
+		reset(&game);
+		chess_set_checkpoints(&game, 1 + g % 10);
+		chess_fen(&game, fens[0]);
+		unsigned int plies = play_on(&game, 0);
+		// go back past a checkpoint or two and play a different line from there
+		unsigned int back = plies ? rand() % plies : 0;
+		while (game.moves > back)
+			chess_undo(&game);
+		plies = play_on(&game, back);
+
+		char got[CHESS_FEN_MAX];
+		char *history = strdup(chess_history(&game));
+		const chess_checkpoint *checks;
+		size_t n_checks = chess_checkpoints(&game, &checks);
+		for (unsigned int i = 0; i <= plies && !failed; ++i) {
+			// back and forth, so seeks come from both sides
+			unsigned int ply = (i % 2) ? plies - i / 2 : i / 2;
+			if (chess_seek(&game, ply) < 0 || (chess_fen(&game, got), strcmp(got, fens[ply]) != 0)) {
+				printf("seek_test: game %d seeks to %s at ply %u, not %s\n", g, got, ply, fens[ply]);
+				failed = 1;
+			}
+			chess_t from;
+			reset(&from);
+			if (chess_seek_history(&from, history, checks, n_checks, ply) < 0
+					|| (chess_fen(&from, got), strcmp(got, fens[ply]) != 0)) {
+				printf("seek_test: game %d's history seeks to %s at ply %u, not %s\n", g, got, ply, fens[ply]);
+				failed = 1;
+			}
+			cleanup(&from);
+			seeks += 2;
+		}
+		if (!failed && CHESS_ERR_NOAVAIL != chess_seek(&game, plies + 1)) {
+			printf("seek_test: game %d seeks past its end\n", g);
+			failed = 1;
+		}
+		free(history);
+		cleanup(&game);
+	}
+	if (!failed)
+		printf("seek_test: %lu seeks\n", seeks);
+	return failed;
+}
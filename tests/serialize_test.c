@@ -0,0 +1,123 @@
+/*
+ * serializes random games and reads them back, then flips bytes in the
+ * saved moves: a ply with a field no move can have must be turned down,
+ * and whatever is taken has to be safe to walk through
+ */
+#include "chess.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GAMES 40
+#define PLIES 120
+#define TAKEN_BACK 6
+// every bit is flipped in this many of the games, it is slow
+#define FLIPPED 3
+
+// a saved ply: the hash, then one byte each for the fields, the last unused
+#define PLY_SIZE 24
+#define PLY_HASH 8
+// where the start and current positions sit in a saved game, each a checkpoint first
+#define START_POS 32
+#define NOW_POS (START_POS + 52)
+
+// plays a random game, taking the last few moves back so some can be redone
+static unsigned int play_random(chess_t *chess) {
+	unsigned int plies = 0;
+	for (; plies < PLIES; ++plies) {
+		chess_move moves[CHESS_MAX_MOVES];
+		size_t n = chess_legal_moves(chess, moves);
+		if (0 == n)
+			break;
+		const chess_move *m = &moves[rand() % n];
+		chess_move_coord(chess, m->x, m->y, m->tx, m->ty, m->promote);
+	}
+	for (int i = 0; i < TAKEN_BACK && plies > 0; ++i)
+		chess_undo(chess);
+	return plies;
+}
+
+int main(void) {
+	srand(1);
+	chess_t game, loaded;
+	reset(&loaded);
+	int failed = 0;
+	unsigned long rejected = 0, flips = 0, taken = 0;
+	for (int g = 0; g < GAMES && !failed; ++g) {
+		reset(&game);
+		chess_set_checkpoints(&game, 1 + g % 16);
+		unsigned int plies = play_random(&game);
+		size_t size = chess_serialize(&game, NULL, 0);
+		unsigned char *buf = malloc(size), *bad = malloc(size);
+		chess_serialize(&game, buf, size);
+
+		char want[CHESS_FEN_MAX], got[CHESS_FEN_MAX];
+		chess_fen(&game, want);
+		if (chess_deserialize(&loaded, buf, size) < 0 || loaded.hash != game.hash) {
+			printf("serialize_test: game %d doesn't read back\n", g);
+			failed = 1;
+		} else if (chess_fen(&loaded, got), strcmp(want, got) != 0) {
+			printf("serialize_test: game %d reads back as %s, not %s\n", g, got, want);
+			failed = 1;
+		} else if (chess_seek(&loaded, plies) < 0 || chess_seek(&game, plies) < 0 || loaded.hash != game.hash) {
+			printf("serialize_test: game %d doesn't redo the same moves\n", g);
+			failed = 1;
+		}
+
+		const chess_checkpoint *checks;
+		size_t saved = plies * PLY_SIZE;
+		size_t head = size - saved - chess_checkpoints(&game, &checks) * sizeof *checks;
+		// 0x7f is out of range for every field of a ply
+		for (size_t at = head; at < head + saved && !failed; ++at) {
+			size_t field = (at - head) % PLY_SIZE;
+			if (field < PLY_HASH || PLY_SIZE - 1 == field)
+				continue;
+			memcpy(bad, buf, size);
+			bad[at] = 0x7f;
+			uint64_t before = loaded.hash;
+			if (0 == chess_deserialize(&loaded, bad, size) || loaded.hash != before) {
+				printf("serialize_test: game %d, byte %zu of ply %zu was taken\n", g, field, (at - head) / PLY_SIZE);
+				failed = 1;
+			}
+			rejected++;
+		}
+		// any one bit flipped anywhere is either turned down or safe to play through
+		for (size_t at = 0; at < size && g < FLIPPED && !failed; ++at) {
+			for (int bit = 0; bit < 8; ++bit, ++flips) {
+				memcpy(bad, buf, size);
+				bad[at] ^= 1 << bit;
+				if (chess_deserialize(&loaded, bad, size) < 0)
+					continue;
+				taken++;
+				chess_seek(&loaded, 0);
+				chess_seek(&loaded, plies);
+				chess_fen(&loaded, got);
+			}
+		}
+		free(buf);
+		free(bad);
+		cleanup(&game);
+	}
+	// with no moves to check them against, the positions alone must hold up
+	reset(&game);
+	size_t size = chess_serialize(&game, NULL, 0);
+	unsigned char *buf = malloc(size);
+	for (int ep = -2; ep < BOARD_LENGTH * BOARD_HEIGHT && !failed; ++ep) {
+		chess_serialize(&game, buf, size);
+		buf[START_POS + offsetof(chess_checkpoint, ep)] = ep;
+		buf[NOW_POS + offsetof(chess_checkpoint, ep)] = ep;
+		// nothing has jumped in the starting position
+		if ((0 == chess_deserialize(&loaded, buf, size)) != (-1 == ep)) {
+			printf("serialize_test: en passant square %d was %s\n", ep, (-1 == ep) ? "turned down" : "taken");
+			failed = 1;
+		}
+		rejected++;
+	}
+	free(buf);
+	cleanup(&game);
+	cleanup(&loaded);
+	if (!failed)
+		printf("serialize_test: %lu bad fields turned down, %lu of %lu flipped bits taken\n", rejected, taken, flips);
+	return failed;
+}
@@ -0,0 +1,97 @@
+/*
+ * plays random games, takes every move back and plays them all again,
+ * checking each position on the way against the one the game was in,
+ * then plays a different move over a taken back one, after which nothing
+ * can be redone
+ */
+#include "chess.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GAMES 100
+#define PLIES 200
+
+static char fens[PLIES + 1][CHESS_FEN_MAX];
+static uint64_t hashes[PLIES + 1];
+// what each move returned, the check state at the start for ply 0
+static chess_return states[PLIES + 1];
+
+// true if the game is in the position it was at ply
+static bool at_ply(const chess_t *chess, unsigned int ply) {
+	char fen[CHESS_FEN_MAX];
+	chess_fen(chess, fen);
+	return chess->moves == ply && chess->hash == hashes[ply] && strcmp(fen, fens[ply]) == 0;
+}
+
+int main(void) {
+	srand(1);
+	int failed = 0;
+	unsigned long steps = 0;
+	for (int g = 0; g < GAMES && !failed; ++g) {
+		chess_t game;
+		reset(&game);
+		unsigned int plies = 0;
+		chess_fen(&game, fens[0]);
+		hashes[0] = game.hash;
+		states[0] = CHESS_NORMAL;
+		for (; plies < PLIES; ++plies) {
+			chess_move moves[CHESS_MAX_MOVES];
+			size_t n = chess_legal_moves(&game, moves);
+			if (0 == n)
+				break;
+			const chess_move *m = &moves[rand() % n];
+			states[plies + 1] = chess_move_coord(&game, m->x, m->y, m->tx, m->ty, m->promote);
+			chess_fen(&game, fens[plies + 1]);
+			hashes[plies + 1] = game.hash;
+		}
+		if (CHESS_ERR_NOAVAIL != chess_redo(&game)) {
+			printf("undo_test: game %d redoes a move it never took back\n", g);
+			failed = 1;
+		}
+		for (unsigned int ply = plies; ply > 0 && !failed; --ply, ++steps) {
+			chess_return ret = chess_undo(&game);
+			if (ret != states[ply - 1] || !at_ply(&game, ply - 1)) {
+				printf("undo_test: game %d takes ply %u back wrong (%d)\n", g, ply, ret);
+				failed = 1;
+			}
+		}
+		if (!failed && CHESS_ERR_NOAVAIL != chess_undo(&game)) {
+			printf("undo_test: game %d takes back a move before the first\n", g);
+			failed = 1;
+		}
+		for (unsigned int ply = 1; ply <= plies && !failed; ++ply, ++steps) {
+			chess_return ret = chess_redo(&game);
+			if (ret != states[ply] || !at_ply(&game, ply)) {
+				printf("undo_test: game %d redoes ply %u wrong (%d)\n", g, ply, ret);
+				failed = 1;
+			}
+		}
+		// a different move where one was taken back drops the rest of the line
+		unsigned int back = plies ? rand() % plies : 0;
+		while (game.moves > back)
+			chess_undo(&game);
+		chess_move moves[CHESS_MAX_MOVES];
+		size_t n = chess_legal_moves(&game, moves);
+		for (size_t i = 0; i < n && !failed; ++i) {
+			const chess_move *m = &moves[i];
+			chess_move_coord(&game, m->x, m->y, m->tx, m->ty, m->promote);
+			if (back < plies && game.hash == hashes[back + 1]) {
+				chess_undo(&game);
+				continue;
+			}
+			if (CHESS_ERR_NOAVAIL != chess_redo(&game)) {
+				printf("undo_test: game %d redoes a move after another was played over it\n", g);
+				failed = 1;
+			} else if (chess_undo(&game) < 0 || !at_ply(&game, back)) {
+				printf("undo_test: game %d doesn't take the new move back to ply %u\n", g, back);
+				failed = 1;
+			}
+			break;
+		}
+		cleanup(&game);
+	}
+	if (!failed)
+		printf("undo_test: %lu moves taken back and redone\n", steps);
+	return failed;
+}